@@ -0,0 +1,46 @@
+// Timing helpers shared by the benchmarks; include this first, before any
+// system header.
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 199309L
+#endif
+
+#include <stdio.h>
+#include <time.h>
+
+// number of times each measurement is repeated; the fastest run is reported
+#define BENCH_RUNS 5
+
+// written by the benchmarks so the compiler can not drop the measured work
+static volatile float bench_sink;
+
+// returns a monotonic time in seconds
+static double bench_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec*1e-9;
+}
+
+// prints the time a run of n iterations took, in total and per iteration
+static void bench_report(const char *name, double seconds, long n) {
+    printf("%-40s %9.3f ms %9.1f ns/iter\n",
+        name, seconds*1e3, seconds*1e9/(double)n);
+}
+
+// runs body BENCH_RUNS times and reports the fastest run of n iterations
+#define BENCH(name, n, body) do { \
+    double bench_best = 1e30; \
+    int bench_run; \
+    for (bench_run = 0; bench_run < BENCH_RUNS; ++bench_run) { \
+        double bench_t0 = bench_now(), bench_t; \
+        body; \
+        bench_t = bench_now() - bench_t0; \
+        if (bench_t < bench_best) bench_best = bench_t; \
+    } \
+    bench_report(name, bench_best, n); \
+} while (0)
+
+#endif // BENCH_H
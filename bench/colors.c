@@ -0,0 +1,71 @@
+// Compares looking up widget colors in the per-theme table against
+// computing them on every draw, as the widget functions did before the
+// table, and puts both next to the cost of drawing the widgets.
+
+#include "bench.h"
+#include "nanovg_stub.h"
+// included for bnd_colors() and the theme indices
+#include "../blendish.c"
+
+#define DRAWS 100000
+
+static const BNDwidgetTheme *widget_theme(int i) {
+    return (const BNDwidgetTheme *)
+        ((const char *)bndGetTheme() + bnd_widget_themes[i]);
+}
+
+static void lookup_colors() {
+    float sum = 0;
+    int i;
+    for (i = 0; i < DRAWS; ++i) {
+        const BNDwidgetColors *c = bnd_colors(i%BND_WIDGET_THEME_COUNT,
+            (BNDwidgetState)(i%3), i&1);
+        sum += c->shade_top.r + c->shade_down.g + c->item_top.b
+            + c->item_down.r + c->outline.a + c->item.a + c->text.r;
+    }
+    bench_sink = sum;
+}
+
+static void compute_colors() {
+    float sum = 0;
+    int i;
+    for (i = 0; i < DRAWS; ++i) {
+        const BNDwidgetTheme *theme = widget_theme(i%BND_WIDGET_THEME_COUNT);
+        BNDwidgetState state = (BNDwidgetState)(i%3);
+        NVGcolor shade_top, shade_down, item_top, item_down;
+        NVGcolor outline, item, text;
+        bndInnerColors(&shade_top, &shade_down, theme, state, i&1);
+        if (state == BND_ACTIVE) {
+            item_top = bndOffsetColor(theme->itemColor, theme->shadeTop);
+            item_down = bndOffsetColor(theme->itemColor, theme->shadeDown);
+        } else {
+            item_top = bndOffsetColor(theme->itemColor, theme->shadeDown);
+            item_down = bndOffsetColor(theme->itemColor, theme->shadeTop);
+        }
+        outline = bndTransparent(theme->outlineColor);
+        item = bndTransparent(theme->itemColor);
+        text = bndTextColor(theme, state);
+        sum += shade_top.r + shade_down.g + item_top.b + item_down.r
+            + outline.a + item.a + text.r;
+    }
+    bench_sink = sum;
+}
+
+static void draw_sliders(NVGcontext *vg) {
+    int i;
+    for (i = 0; i < DRAWS; ++i)
+        bndSlider(vg, 10, 10, 120, BND_WIDGET_HEIGHT, BND_CORNER_NONE,
+            (BNDwidgetState)(i%3), 0.5f, "Slider", "50%");
+}
+
+int main() {
+    NVGcontext *vg = nvgStubCreate();
+    bndSetFont(0);
+
+    BENCH("100k color lookups", DRAWS, lookup_colors());
+    BENCH("100k color computations", DRAWS, compute_colors());
+    BENCH("100k bndSlider draws", DRAWS, draw_sliders(vg));
+
+    nvgStubDelete(vg);
+    return 0;
+}
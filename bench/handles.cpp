@@ -0,0 +1,96 @@
+// Compares small handles packed by uiAllocHandle() against handles aligned
+// by uiAllocHandleAligned(): the time of a whole frame of 100k items with a
+// handle each, of uiEndLayout() alone, which compares all handles bytewise
+// for damage tracking, and of reading all handles back, as well as the
+// buffer space the handles take.
+
+#include "bench.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define OUI_IMPLEMENTATION
+#include "oui.h"
+
+#define ROWS 1000
+#define COLUMNS 100
+#define ITEMS (ROWS*COLUMNS)
+
+typedef struct Widget {
+    const char *label;
+    float value;
+    int kind;
+} Widget;
+
+static unsigned int alignment;
+
+static void declare() {
+    uiBeginLayout();
+    int root = uiItem();
+    uiSetSize(root, 30000, 30000);
+    uiSetBox(root, UI_COLUMN);
+    for (int i = 0; i < ROWS; ++i) {
+        int row = uiItem();
+        uiSetBox(row, UI_ROW);
+        uiInsertBack(root, row);
+        for (int j = 0; j < COLUMNS - 1; ++j) {
+            int item = uiItem();
+            uiSetSize(item, 20, 20);
+            Widget *w = (Widget *)(alignment
+                ? uiAllocHandleAligned(item, sizeof(Widget), alignment)
+                : uiAllocHandle(item, sizeof(Widget)));
+            w->label = "label";
+            w->value = (float)j;
+            w->kind = i;
+            uiInsertBack(row, item);
+        }
+    }
+}
+
+static void read_handles() {
+    float sum = 0;
+    int count = uiGetItemCount();
+    for (int i = 0; i < count; ++i) {
+        const Widget *w = (const Widget *)uiGetHandle(i);
+        if (w) sum += w->value + (float)w->kind;
+    }
+    bench_sink = sum;
+}
+
+static void run(const char *name, unsigned int align) {
+    char label[64];
+    alignment = align;
+    // fill both frame buffers
+    for (int i = 0; i < 2; ++i) {
+        declare();
+        uiEndLayout();
+        uiProcess(0);
+    }
+    snprintf(label, sizeof(label), "%s: frame", name);
+    BENCH(label, ITEMS, {
+        declare();
+        uiEndLayout();
+        uiProcess(0);
+    });
+    declare();
+    double t0 = bench_now();
+    uiEndLayout();
+    snprintf(label, sizeof(label), "%s: uiEndLayout", name);
+    bench_report(label, bench_now() - t0, ITEMS);
+    snprintf(label, sizeof(label), "%s: read", name);
+    BENCH(label, ITEMS, read_handles());
+    printf("%40s %u bytes of handles\n", "", uiGetAllocSize());
+    uiProcess(0);
+}
+
+int main() {
+    UIcontext *ctx = uiCreateContext(ITEMS + ROWS + 1, 1<<22);
+    uiMakeCurrent(ctx);
+
+    run("packed", 0);
+    run("aligned to 8", 8);
+    run("aligned to 16", 16);
+
+    uiDestroyContext(ctx);
+    return 0;
+}
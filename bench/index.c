@@ -0,0 +1,189 @@
+// Checks the wire index against a brute force search over all wires and
+// ports, after inserting, moving and removing some of them, then times
+// lookups through the index. Exits with a non-zero status if a lookup
+// disagrees with the brute force search.
+//
+// The brute force search measures against the wire flattened into many
+// more segments than the index uses, so distances may differ by up to
+// BND_NODE_WIRE_TOLERANCE, or more for wires so long that the index caps
+// them at BND_NODE_WIRE_MAX_SEGMENTS.
+
+#include "bench.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "nanovg_stub.h"
+#include "blendish.h"
+
+#define WIRES 1000
+#define QUERIES 1000
+#define SAMPLES 1000
+#define WIRE_DIST 10.0f
+#define PORT_DIST 50.0f
+// slack for the brute force search, which is not exact either
+#define SLACK 0.01f
+
+static float wires[WIRES][4];
+static int removed[WIRES];
+
+static float wire_point(const float *w, float delta, float t, int y) {
+    float mt = 1 - t;
+    float p0 = w[y], p3 = w[2+y];
+    float p1 = y?p0:(p0 + delta), p2 = y?p3:(p3 - delta);
+    return mt*mt*mt*p0 + 3*mt*mt*t*p1 + 3*mt*t*t*p2 + t*t*t*p3;
+}
+
+// how far the wire flattened by the index may be from the curve; this is
+// the bound bnd_wire_segments() uses, with the same segment limit
+static float wire_error(const float *w, float curving) {
+    float delta = fmaxf(fabsf(w[2] - w[0]), fabsf(w[3] - w[1]))*curving;
+    float m = 6*hypotf(w[2] - w[0] - 3*delta, w[3] - w[1]);
+    float n = fminf(ceilf(sqrtf(m/(8*BND_NODE_WIRE_TOLERANCE))),
+        BND_NODE_WIRE_MAX_SEGMENTS);
+    return fmaxf(m/(8*n*n), BND_NODE_WIRE_TOLERANCE) + SLACK;
+}
+
+// distance of (px,py) to the wire, flattened into SAMPLES segments; wires
+// whose control points are all further than WIRE_DIST away are skipped
+static float wire_distance(const float *w, float curving,
+    float px, float py) {
+    float delta = fmaxf(fabsf(w[2] - w[0]), fabsf(w[3] - w[1]))*curving;
+    float x0 = w[0], y0 = w[1], d = INFINITY;
+    int i;
+    if ((px < fminf(w[0], w[2] - delta) - WIRE_DIST)
+        || (px > fmaxf(w[0] + delta, w[2]) + WIRE_DIST)
+        || (py < fminf(w[1], w[3]) - WIRE_DIST)
+        || (py > fmaxf(w[1], w[3]) + WIRE_DIST))
+        return INFINITY;
+    for (i = 1; i <= SAMPLES; ++i) {
+        float t = (float)i/SAMPLES;
+        float x1 = wire_point(w, delta, t, 0);
+        float y1 = wire_point(w, delta, t, 1);
+        float sx = x1 - x0, sy = y1 - y0, ll = sx*sx + sy*sy;
+        float u = (ll > 0)?((px - x0)*sx + (py - y0)*sy)/ll:0;
+        u = fminf(fmaxf(u, 0), 1);
+        d = fminf(d, hypotf(x0 + u*sx - px, y0 + u*sy - py));
+        x0 = x1;
+        y0 = y1;
+    }
+    return d;
+}
+
+static int check_wire(BNDwireIndex *index, float curving,
+    float px, float py) {
+    float d = -1, best = INFINITY, error = 0;
+    int i, id = bndWireIndexFindWire(index, px, py, WIRE_DIST, &d);
+    for (i = 0; i < WIRES; ++i) {
+        float di = removed[i]?INFINITY
+            :wire_distance(wires[i], curving, px, py);
+        if (di < best) {
+            best = di;
+            error = wire_error(wires[i], curving);
+        }
+    }
+    if (id < 0) {
+        if (best <= WIRE_DIST - error) {
+            printf("wire at %g,%g: none found, %g away\n", px, py, best);
+            return 0;
+        }
+        return 1;
+    }
+    // another wire may be as close within the error, so only the distances
+    // are compared
+    if (removed[id] || (d > best + error)
+        || (fabsf(wire_distance(wires[id], curving, px, py) - d)
+            > wire_error(wires[id], curving))) {
+        printf("wire at %g,%g: found %d at %g, closest is %g away\n",
+            px, py, id, d, best);
+        return 0;
+    }
+    return 1;
+}
+
+static int check_port(BNDwireIndex *index, float px, float py) {
+    float d = -1, best = PORT_DIST;
+    int i, id = bndWireIndexFindPort(index, px, py, PORT_DIST, &d);
+    int expected = -1;
+    for (i = 0; i < WIRES; ++i) {
+        float di = hypotf(wires[i][0] - px, wires[i][1] - py);
+        if (!removed[i] && (di <= best)) {
+            best = di;
+            expected = i;
+        }
+    }
+    if ((id == expected) || ((id >= 0) && (fabsf(d - best) < SLACK)))
+        return 1;
+    printf("port at %g,%g: found %d, expected %d\n", px, py, id, expected);
+    return 0;
+}
+
+static void set_wire(BNDwireIndex *index, int i) {
+    bndWireIndexSetWire(index, i,
+        wires[i][0], wires[i][1], wires[i][2], wires[i][3]);
+    bndWireIndexSetPort(index, i, wires[i][0], wires[i][1]);
+    removed[i] = 0;
+}
+
+static void find_all(BNDwireIndex *index, const float *queries) {
+    int i;
+    for (i = 0; i < QUERIES; ++i)
+        bench_sink += (float)bndWireIndexFindWire(index,
+            queries[2*i], queries[2*i+1], WIRE_DIST, NULL);
+}
+
+int main() {
+    BNDwireIndex *index = bndCreateWireIndex(0);
+    float curving = (float)bndGetTheme()->nodeTheme.noodleCurving/10.0f;
+    static float queries[2*QUERIES];
+    int i, failed = 0;
+
+    srand(1);
+    for (i = 0; i < WIRES; ++i) {
+        int k;
+        for (k = 0; k < 4; ++k)
+            wires[i][k] = (float)(rand()%2000);
+        set_wire(index, i);
+    }
+    // move some wires and ports, remove a few
+    for (i = 0; i < WIRES/4; ++i) {
+        int k = rand()%WIRES;
+        wires[k][0] = (float)(rand()%2000);
+        wires[k][3] = (float)(rand()%2000);
+        set_wire(index, k);
+    }
+    for (i = 0; i < WIRES/100; ++i) {
+        int k = rand()%WIRES;
+        bndWireIndexRemoveWire(index, k);
+        bndWireIndexRemovePort(index, k);
+        removed[k] = 1;
+    }
+
+    for (i = 0; i < QUERIES; ++i) {
+        // half the queries land right next to a wire
+        float px, py;
+        if (i & 1) {
+            const float *w = wires[rand()%WIRES];
+            float delta = fmaxf(fabsf(w[2] - w[0]), fabsf(w[3] - w[1]))
+                *curving;
+            float t = (float)(rand()%1000)/1000;
+            px = wire_point(w, delta, t, 0) + (float)(rand()%25 - 12);
+            py = wire_point(w, delta, t, 1) + (float)(rand()%25 - 12);
+        } else {
+            px = (float)(rand()%2000);
+            py = (float)(rand()%2000);
+        }
+        queries[2*i] = px;
+        queries[2*i+1] = py;
+        if (!check_wire(index, curving, px, py)) ++failed;
+        if (!check_port(index, px, py)) ++failed;
+    }
+    printf("%d of %d lookups disagree with the brute force search\n",
+        failed, 2*QUERIES);
+
+    BENCH("1k wire lookups among 1k wires", QUERIES,
+        find_all(index, queries));
+
+    bndDestroyWireIndex(index);
+    return failed?1:0;
+}
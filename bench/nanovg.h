@@ -0,0 +1,156 @@
+// Declarations of the NanoVG API used by blendish, for building blendish
+// against nanovg_stub.c instead of a real NanoVG and GPU backend. Types and
+// signatures match NanoVG's nanovg.h.
+
+#ifndef NANOVG_H
+#define NANOVG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct NVGcontext NVGcontext;
+
+struct NVGcolor {
+    union {
+        float rgba[4];
+        struct {
+            float r,g,b,a;
+        };
+    };
+};
+typedef struct NVGcolor NVGcolor;
+
+struct NVGpaint {
+    float xform[6];
+    float extent[2];
+    float radius;
+    float feather;
+    NVGcolor innerColor;
+    NVGcolor outerColor;
+    int image;
+};
+typedef struct NVGpaint NVGpaint;
+
+enum NVGwinding {
+    NVG_CCW = 1,
+    NVG_CW = 2,
+};
+
+enum NVGlineCap {
+    NVG_BUTT,
+    NVG_ROUND,
+    NVG_SQUARE,
+    NVG_BEVEL,
+    NVG_MITER,
+};
+
+enum NVGalign {
+    NVG_ALIGN_LEFT = 1<<0,
+    NVG_ALIGN_CENTER = 1<<1,
+    NVG_ALIGN_RIGHT = 1<<2,
+    NVG_ALIGN_TOP = 1<<3,
+    NVG_ALIGN_MIDDLE = 1<<4,
+    NVG_ALIGN_BOTTOM = 1<<5,
+    NVG_ALIGN_BASELINE = 1<<6,
+};
+
+enum NVGimageFlags {
+    NVG_IMAGE_GENERATE_MIPMAPS = 1<<0,
+    NVG_IMAGE_REPEATX = 1<<1,
+    NVG_IMAGE_REPEATY = 1<<2,
+    NVG_IMAGE_FLIPY = 1<<3,
+    NVG_IMAGE_PREMULTIPLIED = 1<<4,
+};
+
+struct NVGglyphPosition {
+    const char* str;
+    float x;
+    float minx, maxx;
+};
+typedef struct NVGglyphPosition NVGglyphPosition;
+
+struct NVGtextRow {
+    const char* start;
+    const char* end;
+    const char* next;
+    float width;
+    float minx, maxx;
+};
+typedef struct NVGtextRow NVGtextRow;
+
+NVGcolor nvgRGBf(float r, float g, float b);
+NVGcolor nvgRGBAf(float r, float g, float b, float a);
+NVGcolor nvgLerpRGBA(NVGcolor c0, NVGcolor c1, float u);
+NVGcolor nvgTransRGBAf(NVGcolor c0, float a);
+
+void nvgSave(NVGcontext* ctx);
+void nvgRestore(NVGcontext* ctx);
+void nvgGlobalAlpha(NVGcontext* ctx, float alpha);
+
+void nvgStrokeColor(NVGcontext* ctx, NVGcolor color);
+void nvgStrokePaint(NVGcontext* ctx, NVGpaint paint);
+void nvgFillColor(NVGcontext* ctx, NVGcolor color);
+void nvgFillPaint(NVGcontext* ctx, NVGpaint paint);
+void nvgStrokeWidth(NVGcontext* ctx, float size);
+void nvgLineCap(NVGcontext* ctx, int cap);
+void nvgLineJoin(NVGcontext* ctx, int join);
+
+void nvgResetTransform(NVGcontext* ctx);
+void nvgTransform(NVGcontext* ctx,
+    float a, float b, float c, float d, float e, float f);
+void nvgCurrentTransform(NVGcontext* ctx, float* xform);
+
+int nvgCreateImageRGBA(NVGcontext* ctx, int w, int h, int imageFlags,
+    const unsigned char* data);
+void nvgDeleteImage(NVGcontext* ctx, int image);
+
+NVGpaint nvgLinearGradient(NVGcontext* ctx, float sx, float sy, float ex,
+    float ey, NVGcolor icol, NVGcolor ocol);
+NVGpaint nvgBoxGradient(NVGcontext* ctx, float x, float y, float w, float h,
+    float r, float f, NVGcolor icol, NVGcolor ocol);
+NVGpaint nvgImagePattern(NVGcontext* ctx, float ox, float oy, float ex,
+    float ey, float angle, int image, float alpha);
+
+void nvgScissor(NVGcontext* ctx, float x, float y, float w, float h);
+void nvgResetScissor(NVGcontext* ctx);
+
+void nvgBeginPath(NVGcontext* ctx);
+void nvgMoveTo(NVGcontext* ctx, float x, float y);
+void nvgLineTo(NVGcontext* ctx, float x, float y);
+void nvgBezierTo(NVGcontext* ctx,
+    float c1x, float c1y, float c2x, float c2y, float x, float y);
+void nvgArcTo(NVGcontext* ctx,
+    float x1, float y1, float x2, float y2, float radius);
+void nvgClosePath(NVGcontext* ctx);
+void nvgRect(NVGcontext* ctx, float x, float y, float w, float h);
+void nvgCircle(NVGcontext* ctx, float cx, float cy, float r);
+void nvgFill(NVGcontext* ctx);
+void nvgStroke(NVGcontext* ctx);
+
+int nvgCreateFont(NVGcontext* ctx, const char* name, const char* filename);
+void nvgFontSize(NVGcontext* ctx, float size);
+void nvgFontBlur(NVGcontext* ctx, float blur);
+void nvgTextAlign(NVGcontext* ctx, int align);
+void nvgFontFaceId(NVGcontext* ctx, int font);
+float nvgText(NVGcontext* ctx, float x, float y,
+    const char* string, const char* end);
+void nvgTextBox(NVGcontext* ctx, float x, float y, float breakRowWidth,
+    const char* string, const char* end);
+float nvgTextBounds(NVGcontext* ctx, float x, float y,
+    const char* string, const char* end, float* bounds);
+void nvgTextBoxBounds(NVGcontext* ctx, float x, float y,
+    float breakRowWidth, const char* string, const char* end, float* bounds);
+int nvgTextGlyphPositions(NVGcontext* ctx, float x, float y,
+    const char* string, const char* end,
+    NVGglyphPosition* positions, int maxPositions);
+void nvgTextMetrics(NVGcontext* ctx,
+    float* ascender, float* descender, float* lineh);
+int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end,
+    float breakRowWidth, NVGtextRow* rows, int maxRows);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NANOVG_H
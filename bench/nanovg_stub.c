@@ -0,0 +1,556 @@
+// A NanoVG without a GPU backend. Paths are recorded and flattened on
+// nvgFill() and nvgStroke() like NanoVG does on the CPU, so timings include
+// the tesselation cost blendish can influence; nothing is rasterized.
+// Text is measured with a fixed advance of half the font size per byte.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "nanovg_stub.h"
+
+#define NVG_STUB_STATES 32
+// NanoVG's default tesselation tolerance at a device pixel ratio of 1
+#define NVG_STUB_TESS_TOL 0.25f
+#define NVG_STUB_KAPPA 0.5522847493f
+
+enum {
+    NVG_STUB_MOVETO,
+    NVG_STUB_LINETO,
+    NVG_STUB_BEZIERTO,
+    NVG_STUB_CLOSE,
+};
+
+typedef struct NVGstubState {
+    float xform[6];
+    float font_size;
+} NVGstubState;
+
+struct NVGcontext {
+    float *commands;
+    int ncommands;
+    int ccommands;
+    float *verts;
+    int nverts;
+    int cverts;
+    // set while verts holds the flattened current path
+    int flattened;
+    float commandx, commandy;
+    NVGstubState states[NVG_STUB_STATES];
+    int nstates;
+    int next_image;
+};
+
+static long nvg_stub_counts[NVG_STUB_COUNT];
+
+static const char *nvg_stub_names[NVG_STUB_COUNT] = {
+    "paths", "fills", "strokes", "paints", "scissors", "text runs",
+    "text measurements", "commands", "vertices",
+};
+
+static NVGstubState *nvg__state(NVGcontext *ctx) {
+    return &ctx->states[ctx->nstates-1];
+}
+
+NVGcontext *nvgStubCreate() {
+    NVGcontext *ctx = (NVGcontext *)calloc(1, sizeof(NVGcontext));
+    ctx->nstates = 1;
+    nvgResetTransform(ctx);
+    nvg__state(ctx)->font_size = 16;
+    return ctx;
+}
+
+void nvgStubDelete(NVGcontext *ctx) {
+    free(ctx->commands);
+    free(ctx->verts);
+    free(ctx);
+}
+
+void nvgStubReset() {
+    memset(nvg_stub_counts, 0, sizeof(nvg_stub_counts));
+}
+
+long nvgStubGet(NVGstubCount count) {
+    return nvg_stub_counts[count];
+}
+
+const char *nvgStubName(NVGstubCount count) {
+    return nvg_stub_names[count];
+}
+
+NVGcolor nvgRGBf(float r, float g, float b) {
+    return nvgRGBAf(r, g, b, 1.0f);
+}
+
+NVGcolor nvgRGBAf(float r, float g, float b, float a) {
+    NVGcolor color;
+    color.r = r;
+    color.g = g;
+    color.b = b;
+    color.a = a;
+    return color;
+}
+
+NVGcolor nvgLerpRGBA(NVGcolor c0, NVGcolor c1, float u) {
+    NVGcolor cint;
+    int i;
+    u = (u < 0)?0:((u > 1)?1:u);
+    for (i = 0; i < 4; ++i)
+        cint.rgba[i] = c0.rgba[i]*(1-u) + c1.rgba[i]*u;
+    return cint;
+}
+
+NVGcolor nvgTransRGBAf(NVGcolor c, float a) {
+    c.a = a;
+    return c;
+}
+
+void nvgSave(NVGcontext *ctx) {
+    if (ctx->nstates >= NVG_STUB_STATES) return;
+    ctx->states[ctx->nstates] = ctx->states[ctx->nstates-1];
+    ctx->nstates++;
+}
+
+void nvgRestore(NVGcontext *ctx) {
+    if (ctx->nstates > 1)
+        ctx->nstates--;
+}
+
+void nvgGlobalAlpha(NVGcontext *ctx, float alpha) {
+    (void)ctx; (void)alpha;
+}
+
+void nvgStrokeColor(NVGcontext *ctx, NVGcolor color) {
+    (void)ctx; (void)color;
+    nvg_stub_counts[NVG_STUB_PAINTS]++;
+}
+
+void nvgStrokePaint(NVGcontext *ctx, NVGpaint paint) {
+    (void)ctx; (void)paint;
+    nvg_stub_counts[NVG_STUB_PAINTS]++;
+}
+
+void nvgFillColor(NVGcontext *ctx, NVGcolor color) {
+    (void)ctx; (void)color;
+    nvg_stub_counts[NVG_STUB_PAINTS]++;
+}
+
+void nvgFillPaint(NVGcontext *ctx, NVGpaint paint) {
+    (void)ctx; (void)paint;
+    nvg_stub_counts[NVG_STUB_PAINTS]++;
+}
+
+void nvgStrokeWidth(NVGcontext *ctx, float size) {
+    (void)ctx; (void)size;
+}
+
+void nvgLineCap(NVGcontext *ctx, int cap) {
+    (void)ctx; (void)cap;
+}
+
+void nvgLineJoin(NVGcontext *ctx, int join) {
+    (void)ctx; (void)join;
+}
+
+void nvgResetTransform(NVGcontext *ctx) {
+    float *t = nvg__state(ctx)->xform;
+    t[0] = 1; t[1] = 0;
+    t[2] = 0; t[3] = 1;
+    t[4] = 0; t[5] = 0;
+}
+
+void nvgTransform(NVGcontext *ctx,
+    float a, float b, float c, float d, float e, float f) {
+    float *t = nvg__state(ctx)->xform;
+    float s[6];
+    // t = s * t, the order NanoVG's nvgTransformPremultiply() uses
+    s[0] = a*t[0] + b*t[2];
+    s[2] = c*t[0] + d*t[2];
+    s[4] = e*t[0] + f*t[2] + t[4];
+    s[1] = a*t[1] + b*t[3];
+    s[3] = c*t[1] + d*t[3];
+    s[5] = e*t[1] + f*t[3] + t[5];
+    memcpy(t, s, sizeof(s));
+}
+
+void nvgCurrentTransform(NVGcontext *ctx, float *xform) {
+    memcpy(xform, nvg__state(ctx)->xform, sizeof(float)*6);
+}
+
+int nvgCreateImageRGBA(NVGcontext *ctx, int w, int h, int imageFlags,
+    const unsigned char *data) {
+    (void)w; (void)h; (void)imageFlags; (void)data;
+    return ++ctx->next_image;
+}
+
+void nvgDeleteImage(NVGcontext *ctx, int image) {
+    (void)ctx; (void)image;
+}
+
+NVGpaint nvgLinearGradient(NVGcontext *ctx, float sx, float sy, float ex,
+    float ey, NVGcolor icol, NVGcolor ocol) {
+    NVGpaint p;
+    (void)ctx;
+    memset(&p, 0, sizeof(p));
+    p.xform[0] = ex - sx;
+    p.xform[1] = ey - sy;
+    p.innerColor = icol;
+    p.outerColor = ocol;
+    return p;
+}
+
+NVGpaint nvgBoxGradient(NVGcontext *ctx, float x, float y, float w, float h,
+    float r, float f, NVGcolor icol, NVGcolor ocol) {
+    NVGpaint p;
+    (void)ctx;
+    memset(&p, 0, sizeof(p));
+    p.xform[4] = x + w*0.5f;
+    p.xform[5] = y + h*0.5f;
+    p.extent[0] = w*0.5f;
+    p.extent[1] = h*0.5f;
+    p.radius = r;
+    p.feather = f;
+    p.innerColor = icol;
+    p.outerColor = ocol;
+    return p;
+}
+
+NVGpaint nvgImagePattern(NVGcontext *ctx, float ox, float oy, float ex,
+    float ey, float angle, int image, float alpha) {
+    NVGpaint p;
+    (void)ctx; (void)angle;
+    memset(&p, 0, sizeof(p));
+    p.xform[0] = 1;
+    p.xform[3] = 1;
+    p.xform[4] = ox;
+    p.xform[5] = oy;
+    p.extent[0] = ex;
+    p.extent[1] = ey;
+    p.image = image;
+    p.innerColor = p.outerColor = nvgRGBAf(1, 1, 1, alpha);
+    return p;
+}
+
+void nvgScissor(NVGcontext *ctx, float x, float y, float w, float h) {
+    (void)ctx; (void)x; (void)y; (void)w; (void)h;
+    nvg_stub_counts[NVG_STUB_SCISSORS]++;
+}
+
+void nvgResetScissor(NVGcontext *ctx) {
+    (void)ctx;
+    nvg_stub_counts[NVG_STUB_SCISSORS]++;
+}
+
+static void nvg__appendCommands(NVGcontext *ctx, const float *vals, int nvals) {
+    const float *t = nvg__state(ctx)->xform;
+    float *cmd;
+    int i;
+    if (ctx->ncommands + nvals > ctx->ccommands) {
+        int ccommands = ctx->ncommands + nvals + ctx->ccommands/2 + 256;
+        ctx->commands = (float *)realloc(ctx->commands,
+            sizeof(float)*ccommands);
+        ctx->ccommands = ccommands;
+    }
+    if ((int)vals[0] != NVG_STUB_CLOSE) {
+        ctx->commandx = vals[nvals-2];
+        ctx->commandy = vals[nvals-1];
+    }
+    cmd = ctx->commands + ctx->ncommands;
+    memcpy(cmd, vals, sizeof(float)*nvals);
+    // points are stored in device space, as in NanoVG
+    for (i = 1; i < nvals; i += 2) {
+        float x = cmd[i], y = cmd[i+1];
+        cmd[i] = x*t[0] + y*t[2] + t[4];
+        cmd[i+1] = x*t[1] + y*t[3] + t[5];
+    }
+    ctx->ncommands += nvals;
+    ctx->flattened = 0;
+    nvg_stub_counts[NVG_STUB_COMMANDS]++;
+}
+
+void nvgBeginPath(NVGcontext *ctx) {
+    ctx->ncommands = 0;
+    ctx->flattened = 0;
+    nvg_stub_counts[NVG_STUB_PATHS]++;
+}
+
+void nvgMoveTo(NVGcontext *ctx, float x, float y) {
+    float vals[] = { NVG_STUB_MOVETO, x, y };
+    nvg__appendCommands(ctx, vals, 3);
+}
+
+void nvgLineTo(NVGcontext *ctx, float x, float y) {
+    float vals[] = { NVG_STUB_LINETO, x, y };
+    nvg__appendCommands(ctx, vals, 3);
+}
+
+void nvgBezierTo(NVGcontext *ctx,
+    float c1x, float c1y, float c2x, float c2y, float x, float y) {
+    float vals[] = { NVG_STUB_BEZIERTO, c1x, c1y, c2x, c2y, x, y };
+    nvg__appendCommands(ctx, vals, 7);
+}
+
+void nvgArcTo(NVGcontext *ctx,
+    float x1, float y1, float x2, float y2, float radius) {
+    // the corner is replaced with a line and one bezier segment; NanoVG
+    // does the same for the arcs of less than 90 degrees blendish draws
+    float x0 = ctx->commandx, y0 = ctx->commandy;
+    float dx0 = x0 - x1, dy0 = y0 - y1;
+    float dx1 = x2 - x1, dy1 = y2 - y1;
+    float l0 = sqrtf(dx0*dx0 + dy0*dy0);
+    float l1 = sqrtf(dx1*dx1 + dy1*dy1);
+    float a, d;
+    if (ctx->ncommands == 0) {
+        nvgMoveTo(ctx, x1, y1);
+        return;
+    }
+    if (l0 < 1e-6f || l1 < 1e-6f || radius < 1e-6f) {
+        nvgLineTo(ctx, x1, y1);
+        return;
+    }
+    dx0 /= l0; dy0 /= l0;
+    dx1 /= l1; dy1 /= l1;
+    a = acosf(dx0*dx1 + dy0*dy1);
+    d = radius / tanf(a/2.0f);
+    if (a < 1e-3f || d > 10000.0f) {
+        nvgLineTo(ctx, x1, y1);
+        return;
+    }
+    nvgLineTo(ctx, x1 + dx0*d, y1 + dy0*d);
+    nvgBezierTo(ctx,
+        x1 + dx0*d*(1-NVG_STUB_KAPPA), y1 + dy0*d*(1-NVG_STUB_KAPPA),
+        x1 + dx1*d*(1-NVG_STUB_KAPPA), y1 + dy1*d*(1-NVG_STUB_KAPPA),
+        x1 + dx1*d, y1 + dy1*d);
+}
+
+void nvgClosePath(NVGcontext *ctx) {
+    float vals[] = { NVG_STUB_CLOSE };
+    nvg__appendCommands(ctx, vals, 1);
+}
+
+void nvgRect(NVGcontext *ctx, float x, float y, float w, float h) {
+    nvgMoveTo(ctx, x, y);
+    nvgLineTo(ctx, x, y+h);
+    nvgLineTo(ctx, x+w, y+h);
+    nvgLineTo(ctx, x+w, y);
+    nvgClosePath(ctx);
+}
+
+void nvgCircle(NVGcontext *ctx, float cx, float cy, float r) {
+    float k = r*NVG_STUB_KAPPA;
+    nvgMoveTo(ctx, cx-r, cy);
+    nvgBezierTo(ctx, cx-r, cy+k, cx-k, cy+r, cx, cy+r);
+    nvgBezierTo(ctx, cx+k, cy+r, cx+r, cy+k, cx+r, cy);
+    nvgBezierTo(ctx, cx+r, cy-k, cx+k, cy-r, cx, cy-r);
+    nvgBezierTo(ctx, cx-k, cy-r, cx-r, cy-k, cx-r, cy);
+    nvgClosePath(ctx);
+}
+
+static void nvg__addPoint(NVGcontext *ctx, float x, float y) {
+    if (ctx->nverts + 1 > ctx->cverts) {
+        int cverts = ctx->nverts + 1 + ctx->cverts/2 + 256;
+        ctx->verts = (float *)realloc(ctx->verts, sizeof(float)*2*cverts);
+        ctx->cverts = cverts;
+    }
+    ctx->verts[ctx->nverts*2] = x;
+    ctx->verts[ctx->nverts*2+1] = y;
+    ctx->nverts++;
+}
+
+static void nvg__tesselateBezier(NVGcontext *ctx,
+    float x1, float y1, float x2, float y2,
+    float x3, float y3, float x4, float y4, int level) {
+    float x12,y12,x23,y23,x34,y34,x123,y123,x234,y234,x1234,y1234;
+    float dx,dy,d2,d3;
+    if (level > 10) return;
+    dx = x4 - x1;
+    dy = y4 - y1;
+    d2 = fabsf(((x2 - x4) * dy - (y2 - y4) * dx));
+    d3 = fabsf(((x3 - x4) * dy - (y3 - y4) * dx));
+    if ((d2 + d3)*(d2 + d3) < NVG_STUB_TESS_TOL * (dx*dx + dy*dy)) {
+        nvg__addPoint(ctx, x4, y4);
+        return;
+    }
+    x12 = (x1+x2)*0.5f; y12 = (y1+y2)*0.5f;
+    x23 = (x2+x3)*0.5f; y23 = (y2+y3)*0.5f;
+    x34 = (x3+x4)*0.5f; y34 = (y3+y4)*0.5f;
+    x123 = (x12+x23)*0.5f; y123 = (y12+y23)*0.5f;
+    x234 = (x23+x34)*0.5f; y234 = (y23+y34)*0.5f;
+    x1234 = (x123+x234)*0.5f; y1234 = (y123+y234)*0.5f;
+    nvg__tesselateBezier(ctx, x1,y1, x12,y12, x123,y123, x1234,y1234,
+        level+1);
+    nvg__tesselateBezier(ctx, x1234,y1234, x234,y234, x34,y34, x4,y4,
+        level+1);
+}
+
+// flattens the current path and returns the number of points; like NanoVG,
+// a path filled and stroked is only flattened once
+static int nvg__flattenPaths(NVGcontext *ctx) {
+    float lastx = 0, lasty = 0;
+    int i = 0;
+    if (ctx->flattened)
+        return ctx->nverts;
+    ctx->flattened = 1;
+    ctx->nverts = 0;
+    while (i < ctx->ncommands) {
+        const float *cmd = ctx->commands + i;
+        switch((int)cmd[0]) {
+        case NVG_STUB_MOVETO:
+        case NVG_STUB_LINETO:
+            nvg__addPoint(ctx, cmd[1], cmd[2]);
+            lastx = cmd[1]; lasty = cmd[2];
+            i += 3;
+            break;
+        case NVG_STUB_BEZIERTO:
+            nvg__tesselateBezier(ctx, lastx, lasty,
+                cmd[1], cmd[2], cmd[3], cmd[4], cmd[5], cmd[6], 0);
+            lastx = cmd[5]; lasty = cmd[6];
+            i += 7;
+            break;
+        default:
+            i += 1;
+            break;
+        }
+    }
+    return ctx->nverts;
+}
+
+void nvgFill(NVGcontext *ctx) {
+    // the fill and its antialiased fringe
+    nvg_stub_counts[NVG_STUB_VERTICES] += nvg__flattenPaths(ctx)*3;
+    nvg_stub_counts[NVG_STUB_FILLS]++;
+}
+
+void nvgStroke(NVGcontext *ctx) {
+    // both sides of the stroke
+    nvg_stub_counts[NVG_STUB_VERTICES] += nvg__flattenPaths(ctx)*2;
+    nvg_stub_counts[NVG_STUB_STROKES]++;
+}
+
+int nvgCreateFont(NVGcontext *ctx, const char *name, const char *filename) {
+    (void)ctx; (void)name; (void)filename;
+    return 0;
+}
+
+void nvgFontSize(NVGcontext *ctx, float size) {
+    nvg__state(ctx)->font_size = size;
+}
+
+void nvgFontBlur(NVGcontext *ctx, float blur) {
+    (void)ctx; (void)blur;
+}
+
+void nvgTextAlign(NVGcontext *ctx, int align) {
+    (void)ctx; (void)align;
+}
+
+void nvgFontFaceId(NVGcontext *ctx, int font) {
+    (void)ctx; (void)font;
+}
+
+static float nvg__advance(NVGcontext *ctx) {
+    return nvg__state(ctx)->font_size*0.5f;
+}
+
+static const char *nvg__end(const char *string, const char *end) {
+    return end?end:(string + strlen(string));
+}
+
+float nvgText(NVGcontext *ctx, float x, float y,
+    const char *string, const char *end) {
+    (void)y;
+    nvg_stub_counts[NVG_STUB_TEXT_RUNS]++;
+    return x + nvg__advance(ctx)*(nvg__end(string, end) - string);
+}
+
+void nvgTextBox(NVGcontext *ctx, float x, float y, float breakRowWidth,
+    const char *string, const char *end) {
+    (void)ctx; (void)x; (void)y; (void)breakRowWidth;
+    (void)string; (void)end;
+    nvg_stub_counts[NVG_STUB_TEXT_RUNS]++;
+}
+
+float nvgTextBounds(NVGcontext *ctx, float x, float y,
+    const char *string, const char *end, float *bounds) {
+    float size = nvg__state(ctx)->font_size;
+    float w = nvg__advance(ctx)*(nvg__end(string, end) - string);
+    nvg_stub_counts[NVG_STUB_TEXT_MEASUREMENTS]++;
+    if (bounds) {
+        bounds[0] = x;
+        bounds[1] = y - size*0.8f;
+        bounds[2] = x + w;
+        bounds[3] = y + size*0.2f;
+    }
+    return w;
+}
+
+static int nvg__breakLines(NVGcontext *ctx, const char *string,
+    const char *end, float breakRowWidth, NVGtextRow *rows, int maxRows) {
+    float advance = nvg__advance(ctx);
+    int perRow = (int)(breakRowWidth / advance);
+    int nrows = 0;
+    end = nvg__end(string, end);
+    if (perRow < 1) perRow = 1;
+    while (string < end && (!rows || nrows < maxRows)) {
+        const char *next = string + perRow;
+        if (next > end) next = end;
+        if (rows) {
+            NVGtextRow *row = rows + nrows;
+            row->start = string;
+            row->end = next;
+            row->next = next;
+            row->width = advance*(next - string);
+            row->minx = 0;
+            row->maxx = row->width;
+        }
+        nrows++;
+        string = next;
+    }
+    return nrows;
+}
+
+void nvgTextBoxBounds(NVGcontext *ctx, float x, float y,
+    float breakRowWidth, const char *string, const char *end, float *bounds) {
+    float size = nvg__state(ctx)->font_size;
+    int nrows = nvg__breakLines(ctx, string, end, breakRowWidth, NULL, 0);
+    nvg_stub_counts[NVG_STUB_TEXT_MEASUREMENTS]++;
+    if (bounds) {
+        bounds[0] = x;
+        bounds[1] = y - size*0.8f;
+        bounds[2] = x + breakRowWidth;
+        bounds[3] = y - size*0.8f + nrows*size*1.2f;
+    }
+}
+
+int nvgTextGlyphPositions(NVGcontext *ctx, float x, float y,
+    const char *string, const char *end,
+    NVGglyphPosition *positions, int maxPositions) {
+    float advance = nvg__advance(ctx);
+    int n = 0;
+    (void)y;
+    end = nvg__end(string, end);
+    nvg_stub_counts[NVG_STUB_TEXT_MEASUREMENTS]++;
+    while (string + n < end && n < maxPositions) {
+        positions[n].str = string + n;
+        positions[n].x = x + advance*n;
+        positions[n].minx = positions[n].x;
+        positions[n].maxx = positions[n].x + advance;
+        n++;
+    }
+    return n;
+}
+
+void nvgTextMetrics(NVGcontext *ctx,
+    float *ascender, float *descender, float *lineh) {
+    float size = nvg__state(ctx)->font_size;
+    nvg_stub_counts[NVG_STUB_TEXT_MEASUREMENTS]++;
+    if (ascender) *ascender = size*0.8f;
+    if (descender) *descender = -size*0.2f;
+    if (lineh) *lineh = size*1.2f;
+}
+
+int nvgTextBreakLines(NVGcontext *ctx, const char *string, const char *end,
+    float breakRowWidth, NVGtextRow *rows, int maxRows) {
+    nvg_stub_counts[NVG_STUB_TEXT_MEASUREMENTS]++;
+    return nvg__breakLines(ctx, string, end, breakRowWidth, rows, maxRows);
+}
@@ -0,0 +1,58 @@
+// Counters of the stub NanoVG in nanovg_stub.c.
+
+#ifndef NANOVG_STUB_H
+#define NANOVG_STUB_H
+
+#include "nanovg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// kinds of work counted by the stub
+typedef enum NVGstubCount {
+    // nvgBeginPath()
+    NVG_STUB_PATHS = 0,
+    // nvgFill()
+    NVG_STUB_FILLS,
+    // nvgStroke()
+    NVG_STUB_STROKES,
+    // nvgFillColor(), nvgFillPaint(), nvgStrokeColor(), nvgStrokePaint()
+    NVG_STUB_PAINTS,
+    // nvgScissor(), nvgResetScissor()
+    NVG_STUB_SCISSORS,
+    // nvgText(), nvgTextBox()
+    NVG_STUB_TEXT_RUNS,
+    // nvgTextBounds(), nvgTextBoxBounds(), nvgTextBreakLines(),
+    // nvgTextGlyphPositions(), nvgTextMetrics()
+    NVG_STUB_TEXT_MEASUREMENTS,
+    // nvgMoveTo(), nvgLineTo(), nvgBezierTo(), nvgArcTo(), nvgClosePath(),
+    // and the commands nvgRect() and nvgCircle() expand to
+    NVG_STUB_COMMANDS,
+    // vertices written by nvgFill() and nvgStroke() after flattening
+    // curves the way NanoVG does
+    NVG_STUB_VERTICES,
+
+    NVG_STUB_COUNT
+} NVGstubCount;
+
+// returns a context for the stub; all contexts share the same counters
+NVGcontext *nvgStubCreate();
+
+// free the memory held by the stub
+void nvgStubDelete(NVGcontext *ctx);
+
+// reset all counters to zero
+void nvgStubReset();
+
+// returns the counter for the given kind of work since nvgStubReset()
+long nvgStubGet(NVGstubCount count);
+
+// returns a short name for the given kind of work
+const char *nvgStubName(NVGstubCount count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NANOVG_STUB_H
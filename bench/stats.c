@@ -0,0 +1,175 @@
+// Draws a frame of widgets, nodes and wires with a blendish built with
+// BLENDISH_STATS and prints the nanovg calls counted per public function,
+// next to the totals the stub NanoVG counted itself. Exits with a non-zero
+// status if the paths, fills or strokes of a function differ from the ones
+// recorded below, or if the totals differ from the stub's own counts.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "nanovg_stub.h"
+#include "blendish.h"
+
+static const char *stat_names[BND_STAT_COUNT] = {
+    "paths", "fills", "strokes", "colors", "linear", "box", "image",
+    "scissor", "text", "measure", "state",
+};
+
+// expected counts for the frame drawn by draw_frame(); update them together
+// with changes that are meant to change what blendish hands to NanoVG
+typedef struct Expected {
+    const char *function;
+    int paths, fills, strokes;
+} Expected;
+
+static const Expected expected[] = {
+    { "bndBackground",         1,  1, 0 },
+    { "bndSplitterWidgets",    3,  0, 3 },
+    { "bndMenuBackground",     3,  2, 1 },
+    { "bndMenuLabel",          1,  0, 0 },
+    { "bndMenuItem",           3,  2, 0 },
+    { "bndTooltipBackground",  3,  2, 1 },
+    { "bndLabel",              4,  0, 0 },
+    { "bndToolButton",        16,  8, 4 },
+    { "bndRadioButton",       12,  4, 4 },
+    { "bndTextField",         13,  5, 4 },
+    { "bndOptionButton",      13,  4, 5 },
+    { "bndChoiceButton",      16,  8, 4 },
+    { "bndColorButton",        8,  4, 4 },
+    { "bndNumberField",       20, 12, 4 },
+    { "bndSlider",            12,  8, 4 },
+    { "bndScrollBar",         16,  8, 8 },
+    { "bndNodeBackground",    11,  7, 2 },
+    { "bndNodePort",           2,  2, 2 },
+    { "bndNodeWire",           1,  0, 2 },
+    { "bndColoredNodeWire",    1,  0, 2 },
+};
+
+#define EXPECTED_COUNT (int)(sizeof(expected)/sizeof(expected[0]))
+
+// compares the counted calls against the expected ones; returns the number
+// of mismatches and prints each of them
+static int check_stats() {
+    const BNDstats *stats;
+    int i, k, failed = 0;
+    for (i = 0; i < EXPECTED_COUNT; ++i) {
+        const Expected *e = &expected[i];
+        for (k = 0; k < bndGetStatsCount(); ++k) {
+            stats = bndGetStatsEntry(k);
+            if (!strcmp(stats->function, e->function)) break;
+        }
+        if (k == bndGetStatsCount()) {
+            printf("%s: not drawn\n", e->function);
+            ++failed;
+            continue;
+        }
+        if ((stats->counts[BND_STAT_PATHS] != e->paths)
+            || (stats->counts[BND_STAT_FILLS] != e->fills)
+            || (stats->counts[BND_STAT_STROKES] != e->strokes)) {
+            printf("%s: %d paths, %d fills, %d strokes; expected %d, %d, %d\n",
+                e->function, stats->counts[BND_STAT_PATHS],
+                stats->counts[BND_STAT_FILLS], stats->counts[BND_STAT_STROKES],
+                e->paths, e->fills, e->strokes);
+            ++failed;
+        }
+    }
+    if (bndGetStatsCount() != EXPECTED_COUNT) {
+        printf("%d functions drawn, expected %d\n",
+            bndGetStatsCount(), EXPECTED_COUNT);
+        ++failed;
+    }
+    stats = bndGetStats();
+    if ((stats->counts[BND_STAT_PATHS] != nvgStubGet(NVG_STUB_PATHS))
+        || (stats->counts[BND_STAT_FILLS] != nvgStubGet(NVG_STUB_FILLS))
+        || (stats->counts[BND_STAT_STROKES] != nvgStubGet(NVG_STUB_STROKES))) {
+        printf("totals differ from the stub's counts\n");
+        ++failed;
+    }
+    return failed;
+}
+
+static void draw_frame(NVGcontext *vg) {
+    int i;
+    float x = 10, y = 10;
+    NVGcolor wire0 = nvgRGBf(0.8f, 0.6f, 0.2f);
+    NVGcolor wire1 = nvgRGBf(0.2f, 0.6f, 0.8f);
+
+    bndBackground(vg, 0, 0, 800, 600);
+    bndSplitterWidgets(vg, 0, 0, 800, 600);
+    bndMenuBackground(vg, 600, 10, 150, 120, BND_CORNER_TOP);
+    bndMenuLabel(vg, 605, 15, 140, BND_WIDGET_HEIGHT, -1, "Menu");
+    bndMenuItem(vg, 605, 40, 140, BND_WIDGET_HEIGHT, BND_HOVER,
+        BND_ICONID(17,3), "Open");
+    bndTooltipBackground(vg, 600, 200, 150, 60);
+
+    for (i = 0; i < 4; ++i) {
+        BNDwidgetState state = (BNDwidgetState)(i%3);
+        bndLabel(vg, x, y, 120, BND_WIDGET_HEIGHT, -1, "Label");
+        bndToolButton(vg, x, y+25, 120, BND_WIDGET_HEIGHT, BND_CORNER_NONE,
+            state, BND_ICONID(6,3), "Tool");
+        bndRadioButton(vg, x, y+50, 120, BND_WIDGET_HEIGHT, BND_CORNER_NONE,
+            state, -1, "Radio");
+        bndTextField(vg, x, y+75, 120, BND_WIDGET_HEIGHT, BND_CORNER_NONE,
+            state, -1, "Editable text", 2, 6);
+        bndOptionButton(vg, x, y+100, 120, BND_WIDGET_HEIGHT, state,
+            "Option");
+        bndChoiceButton(vg, x, y+125, 120, BND_WIDGET_HEIGHT,
+            BND_CORNER_NONE, state, -1, "Choice");
+        bndColorButton(vg, x, y+150, 120, BND_WIDGET_HEIGHT,
+            BND_CORNER_NONE, wire0);
+        bndNumberField(vg, x, y+175, 120, BND_WIDGET_HEIGHT,
+            BND_CORNER_NONE, state, "Number", "42");
+        bndSlider(vg, x, y+200, 120, BND_WIDGET_HEIGHT, BND_CORNER_NONE,
+            state, 0.25f*i, "Slider", "25%");
+        bndScrollBar(vg, x, y+225, 120, BND_SCROLLBAR_HEIGHT, state,
+            0.5f, 0.25f);
+        x += 140;
+    }
+
+    bndNodeBackground(vg, 10, 300, 200, 120, BND_DEFAULT,
+        BND_ICONID(2,5), "Node", wire0);
+    bndNodePort(vg, 210, 340, BND_DEFAULT, wire0);
+    bndNodeBackground(vg, 400, 300, 200, 120, BND_ACTIVE,
+        -1, "Other node", wire1);
+    bndNodePort(vg, 400, 380, BND_HOVER, wire1);
+    bndNodeWire(vg, 210, 340, 400, 380, BND_DEFAULT, BND_HOVER);
+    bndColoredNodeWire(vg, 210, 340, 400, 330, wire0, wire1);
+}
+
+int main() {
+    NVGcontext *vg = nvgStubCreate();
+    const BNDstats *stats;
+    int i, k, failed;
+
+    bndSetFont(0);
+    bndSetIconImage(nvgCreateImageRGBA(vg, 602, 640, 0, NULL));
+    bndResetStats();
+    nvgStubReset();
+    draw_frame(vg);
+
+    printf("%-24s", "function");
+    for (k = 0; k < BND_STAT_COUNT; ++k)
+        printf(" %7s", stat_names[k]);
+    printf("\n");
+    for (i = 0; i < bndGetStatsCount(); ++i) {
+        stats = bndGetStatsEntry(i);
+        printf("%-24s", stats->function);
+        for (k = 0; k < BND_STAT_COUNT; ++k)
+            printf(" %7d", stats->counts[k]);
+        printf("\n");
+    }
+    stats = bndGetStats();
+    printf("%-24s", "total");
+    for (k = 0; k < BND_STAT_COUNT; ++k)
+        printf(" %7d", stats->counts[k]);
+    printf("\n\nstub:");
+    for (k = 0; k < NVG_STUB_COUNT; ++k)
+        printf(" %s %ld%s", nvgStubName((NVGstubCount)k),
+            nvgStubGet((NVGstubCount)k), (k + 1 < NVG_STUB_COUNT)?",":"\n");
+
+    failed = check_stats();
+    printf("%d mismatches against the expected counts\n", failed);
+
+    nvgStubDelete(vg);
+    return failed?1:0;
+}
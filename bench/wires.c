@@ -0,0 +1,81 @@
+// Times drawing 10k node wires one by one with bndColoredNodeWire() and
+// at once with bndColoredNodeWires(), and prints the strokes, path commands
+// and vertices each way hands to NanoVG. The wires use a palette of four
+// colors first, then a distinct color each, which leaves nothing to group.
+
+#include "bench.h"
+
+#include <stdlib.h>
+
+#include "nanovg_stub.h"
+#include "blendish.h"
+
+#define WIRES 10000
+#define COLORS 4
+
+static float points[4*WIRES];
+static NVGcolor colors[2*WIRES];
+
+static void make_wires(int distinct) {
+    NVGcolor palette[COLORS];
+    int i;
+    palette[0] = nvgRGBf(0.8f, 0.6f, 0.2f);
+    palette[1] = nvgRGBf(0.2f, 0.6f, 0.8f);
+    palette[2] = nvgRGBf(0.6f, 0.8f, 0.2f);
+    palette[3] = nvgRGBAf(0.8f, 0.2f, 0.6f, 0.5f);
+    srand(1);
+    for (i = 0; i < WIRES; ++i) {
+        float x0 = (float)(rand()%1500);
+        float y0 = (float)(rand()%1000);
+        points[4*i] = x0;
+        points[4*i+1] = y0;
+        points[4*i+2] = x0 + 50 + (float)(rand()%400);
+        points[4*i+3] = (float)(rand()%1000);
+        // one wire in 8 connects ports of different colors
+        colors[2*i] = distinct
+            ? nvgRGBf((float)(i&255)/255, (float)(i>>8)/255, 0.5f)
+            : palette[i%COLORS];
+        colors[2*i+1] = (i%8)?colors[2*i]:palette[(i+1)%COLORS];
+    }
+}
+
+static void draw_single(NVGcontext *vg) {
+    int i;
+    for (i = 0; i < WIRES; ++i)
+        bndColoredNodeWire(vg, points[4*i], points[4*i+1],
+            points[4*i+2], points[4*i+3], colors[2*i], colors[2*i+1]);
+}
+
+static void draw_batch(NVGcontext *vg) {
+    bndColoredNodeWires(vg, WIRES, points, colors);
+}
+
+static void print_counts() {
+    printf("%40s %ld strokes, %ld commands, %ld vertices\n", "",
+        nvgStubGet(NVG_STUB_STROKES), nvgStubGet(NVG_STUB_COMMANDS),
+        nvgStubGet(NVG_STUB_VERTICES));
+}
+
+static void run(const char *name, int distinct, NVGcontext *vg) {
+    char single[64], batch[64];
+    make_wires(distinct);
+    snprintf(single, sizeof(single), "10k %s bndColoredNodeWire", name);
+    snprintf(batch, sizeof(batch), "10k %s bndColoredNodeWires", name);
+
+    BENCH(single, WIRES, draw_single(vg));
+    nvgStubReset();
+    draw_single(vg);
+    print_counts();
+    BENCH(batch, WIRES, draw_batch(vg));
+    nvgStubReset();
+    draw_batch(vg);
+    print_counts();
+}
+
+int main() {
+    NVGcontext *vg = nvgStubCreate();
+    run("palette", 0, vg);
+    run("distinct", 1, vg);
+    nvgStubDelete(vg);
+    return 0;
+}
@@ -0,0 +1,145 @@
+// Times a column of 10k wrapped paragraphs laid out in one uiEndLayout()
+// with a measure handler that computes heights for final widths, against
+// the workaround of laying the frame out twice: once to learn the widths
+// and once more with heights set from them.
+// Then times the layout of a UI_ROW|UI_WRAP tile view at an unchanged width,
+// at widths that move few line breaks, and while it is resized.
+
+#include "bench.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define OUI_IMPLEMENTATION
+#include "oui.h"
+
+#define PARAGRAPHS 10000
+// width of a character and height of a line of text in pixels
+#define CHAR_WIDTH 7
+#define LINE_HEIGHT 15
+
+static int text_length(int paragraph) {
+    return 40 + (paragraph*37)%400;
+}
+
+static int text_height(int paragraph, int width) {
+    int chars = width/CHAR_WIDTH;
+    if (chars < 1) chars = 1;
+    return LINE_HEIGHT*((text_length(paragraph) + chars - 1)/chars);
+}
+
+static int measure(int item, int dim) {
+    // the handle holds the paragraph index
+    int paragraph = *(const int *)uiGetHandle(item);
+    if (!dim)
+        return text_length(paragraph)*CHAR_WIDTH;
+    return text_height(paragraph, uiGetWidth(item));
+}
+
+static int widths[PARAGRAPHS + 1];
+static int heights[PARAGRAPHS + 1];
+
+// declares the column; heights are left to the measure handler unless
+// widths from an earlier layout are passed
+static void declare(const int *known_widths) {
+    uiBeginLayout();
+    int root = uiItem();
+    uiSetSize(root, 600, 0);
+    uiSetBox(root, UI_COLUMN);
+    for (int i = 0; i < PARAGRAPHS; ++i) {
+        int item = uiItem();
+        uiSetLayout(item, UI_HFILL);
+        uiSetMargins(item, 10 + (i%3)*20, 0, 10, 4);
+        *(int *)uiAllocHandle(item, sizeof(int)) = i;
+        if (known_widths)
+            uiSetSize(item, 0, text_height(i, known_widths[item]));
+        uiInsertBack(root, item);
+    }
+}
+
+static void single_pass() {
+    declare(NULL);
+    uiEndLayout();
+    uiProcess(0);
+}
+
+static void two_passes() {
+    // the first layout only provides the widths
+    declare(NULL);
+    uiEndLayout();
+    int count = uiGetItemCount();
+    for (int i = 0; i < count; ++i)
+        widths[i] = uiGetWidth(i);
+    uiProcess(0);
+    declare(widths);
+    uiEndLayout();
+    uiProcess(0);
+}
+
+#define TILES 4000
+#define TILE_FRAMES 50
+
+// declares the tile view at the given width; returns the time
+// uiEndLayout() takes to lay it out
+static double tile_frame(int width) {
+    uiBeginLayout();
+    int root = uiItem();
+    uiSetSize(root, width, 0);
+    uiSetBox(root, UI_ROW|UI_WRAP|UI_START);
+    for (int i = 0; i < TILES; ++i) {
+        int item = uiItem();
+        uiSetSize(item, 60 + (i*13)%50, 40);
+        uiSetMargins(item, 2, 2, 2, 2);
+        uiInsertBack(root, item);
+    }
+    double t0 = bench_now();
+    uiEndLayout();
+    double t = bench_now() - t0;
+    uiProcess(0);
+    return t;
+}
+
+// reports the fastest of BENCH_RUNS runs of TILE_FRAMES frames, each step
+// pixels wider than the last; with bounce, every other frame is as wide as
+// the first
+static void tile_frames(const char *name, int width, int step, bool bounce) {
+    double best = 1e30;
+    for (int run = 0; run < BENCH_RUNS; ++run) {
+        double t = 0.0;
+        for (int i = 0; i < TILE_FRAMES; ++i)
+            t += tile_frame(width + (bounce?(i%2):i)*step);
+        if (t < best) best = t;
+    }
+    bench_report(name, best, (long)TILES*TILE_FRAMES);
+}
+
+int main() {
+    UIcontext *ctx = uiCreateContext(PARAGRAPHS + 1, PARAGRAPHS*8);
+    uiMakeCurrent(ctx);
+    uiSetMeasureHandler(measure);
+
+    BENCH("10k paragraphs, one layout", PARAGRAPHS, single_pass());
+    declare(NULL);
+    uiEndLayout();
+    int count = uiGetItemCount();
+    for (int i = 0; i < count; ++i)
+        heights[i] = uiGetHeight(i);
+    uiProcess(0);
+    BENCH("10k paragraphs, laid out twice", PARAGRAPHS, two_passes());
+
+    // both ways must arrive at the same heights
+    int mismatches = 0;
+    declare(widths);
+    uiEndLayout();
+    for (int i = 1; i < count; ++i)
+        mismatches += (uiGetHeight(i) != heights[i]);
+    printf("%40s %d of %d heights differ\n", "", mismatches, count - 1);
+    uiProcess(0);
+
+    tile_frames("4k tiles layout, same width", 1000, 0, false);
+    tile_frames("4k tiles layout, width +-1", 1000, 1, true);
+    tile_frames("4k tiles layout, resized", 800, 3, false);
+
+    uiDestroyContext(ctx);
+    return 0;
+}
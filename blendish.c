@@ -24,6 +24,8 @@ THE SOFTWARE.
 
 
 #include <memory.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <blendish.h>
 
@@ -74,254 +76,836 @@ static BND_INLINE float bnd_clamp(float v, float mn, float mx) {
     return (v > mx)?mx:(v < mn)?mn:v;
 }
 
+// storage class of the current context pointer; you can override this from
+// the outside if your compiler spells thread local storage differently
+#ifndef BND_THREAD_LOCAL
+    #if defined(_MSC_VER)
+    #define BND_THREAD_LOCAL __declspec(thread)
+    #elif defined(__cplusplus) && (__cplusplus >= 201103L)
+    #define BND_THREAD_LOCAL thread_local
+    #elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) \
+        && !defined(__STDC_NO_THREADS__)
+    #define BND_THREAD_LOCAL _Thread_local
+    #else
+    #define BND_THREAD_LOCAL __thread
+    #endif
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 
-// the initial theme
-static BNDtheme bnd_theme = {
-    // backgroundColor
-    {{{ 0.447, 0.447, 0.447, 1.0 }}},
-    // regularTheme
-    {
-        {{{ 0.098,0.098,0.098,1 }}}, // color_outline
-        {{{ 0.098,0.098,0.098,1 }}}, // color_item
-        {{{ 0.6,0.6,0.6,1 }}}, // color_inner
-        {{{ 0.392,0.392,0.392,1 }}}, // color_inner_selected
-        BND_COLOR_TEXT, // color_text
-        BND_COLOR_TEXT_SELECTED, // color_text_selected
-        0, // shade_top
-        0, // shade_down
-    },
-    // toolTheme
-    {
-        {{{ 0.098,0.098,0.098,1 }}}, // color_outline
-        {{{ 0.098,0.098,0.098,1 }}}, // color_item
-        {{{ 0.6,0.6,0.6,1 }}}, // color_inner
-        {{{ 0.392,0.392,0.392,1 }}}, // color_inner_selected
-        BND_COLOR_TEXT, // color_text
-        BND_COLOR_TEXT_SELECTED, // color_text_selected
-        15, // shade_top
-        -15, // shade_down
-    },
-    // radioTheme
-    {
-        {{{ 0,0,0,1 }}}, // color_outline
-        {{{ 1,1,1,1 }}}, // color_item
-        {{{ 0.275,0.275,0.275,1 }}}, // color_inner
-        {{{ 0.337,0.502,0.761,1 }}}, // color_inner_selected
-        BND_COLOR_TEXT_SELECTED, // color_text
-        BND_COLOR_TEXT, // color_text_selected
-        15, // shade_top
-        -15, // shade_down
-    },
-    // textFieldTheme
-    {
-        {{{ 0.098,0.098,0.098,1 }}}, // color_outline
-        {{{ 0.353, 0.353, 0.353,1 }}}, // color_item
-        {{{ 0.6, 0.6, 0.6,1 }}}, // color_inner
-        {{{ 0.6, 0.6, 0.6,1 }}}, // color_inner_selected
-        BND_COLOR_TEXT, // color_text
-        BND_COLOR_TEXT_SELECTED, // color_text_selected
-        0, // shade_top
-        25, // shade_down
-    },
-    // optionTheme
-    {
-        {{{ 0,0,0,1 }}}, // color_outline
-        {{{ 1,1,1,1 }}}, // color_item
-        {{{ 0.275,0.275,0.275,1 }}}, // color_inner
-        {{{ 0.275,0.275,0.275,1 }}}, // color_inner_selected
-        BND_COLOR_TEXT, // color_text
-        BND_COLOR_TEXT_SELECTED, // color_text_selected
-        15, // shade_top
-        -15, // shade_down
-    },
-    // choiceTheme
-    {
-        {{{ 0,0,0,1 }}}, // color_outline
-        {{{ 1,1,1,1 }}}, // color_item
-        {{{ 0.275,0.275,0.275,1 }}}, // color_inner
-        {{{ 0.275,0.275,0.275,1 }}}, // color_inner_selected
-        BND_COLOR_TEXT_SELECTED, // color_text
-        {{{ 0.8,0.8,0.8,1 }}}, // color_text_selected
-        15, // shade_top
-        -15, // shade_down
-    },
-    // numberFieldTheme
-    {
-        {{{ 0.098,0.098,0.098,1 }}}, // color_outline
-        {{{ 0.353, 0.353, 0.353,1 }}}, // color_item
-        {{{ 0.706, 0.706, 0.706,1 }}}, // color_inner
-        {{{ 0.6, 0.6, 0.6,1 }}}, // color_inner_selected
-        BND_COLOR_TEXT, // color_text
-        BND_COLOR_TEXT_SELECTED, // color_text_selected
-        -20, // shade_top
-        0, // shade_down
-    },
-    // sliderTheme
-    {
-        {{{ 0.098,0.098,0.098,1 }}}, // color_outline
-        {{{ 0.502,0.502,0.502,1 }}}, // color_item
-        {{{ 0.706, 0.706, 0.706,1 }}}, // color_inner
-        {{{ 0.6, 0.6, 0.6,1 }}}, // color_inner_selected
-        BND_COLOR_TEXT, // color_text
-        BND_COLOR_TEXT_SELECTED, // color_text_selected
-        -20, // shade_top
-        0, // shade_down
-    },
-    // scrollBarTheme
-    {
-        {{{ 0.196,0.196,0.196,1 }}}, // color_outline
-        {{{ 0.502,0.502,0.502,1 }}}, // color_item
-        {{{ 0.314, 0.314, 0.314,0.706 }}}, // color_inner
-        {{{ 0.392, 0.392, 0.392,0.706 }}}, // color_inner_selected
-        BND_COLOR_TEXT, // color_text
-        BND_COLOR_TEXT_SELECTED, // color_text_selected
-        5, // shade_top
-        -5, // shade_down
-    },
-    // tooltipTheme
-    {
-        {{{ 0,0,0,1 }}}, // color_outline
-        {{{ 0.392,0.392,0.392,1 }}}, // color_item
-        {{{ 0.098, 0.098, 0.098, 0.902 }}}, // color_inner
-        {{{ 0.176, 0.176, 0.176, 0.902 }}}, // color_inner_selected
-        {{{ 0.627, 0.627, 0.627, 1 }}}, // color_text
-        BND_COLOR_TEXT_SELECTED, // color_text_selected
-        0, // shade_top
-        0, // shade_down
-    },
-    // menuTheme
-    {
-        {{{ 0,0,0,1 }}}, // color_outline
-        {{{ 0.392,0.392,0.392,1 }}}, // color_item
-        {{{ 0.098, 0.098, 0.098, 0.902 }}}, // color_inner
-        {{{ 0.176, 0.176, 0.176, 0.902 }}}, // color_inner_selected
-        {{{ 0.627, 0.627, 0.627, 1 }}}, // color_text
-        BND_COLOR_TEXT_SELECTED, // color_text_selected
-        0, // shade_top
-        0, // shade_down
-    },
-    // menuItemTheme
-    {
-        {{{ 0,0,0,1 }}}, // color_outline
-        {{{ 0.675,0.675,0.675,0.502 }}}, // color_item
-        {{{ 0,0,0,0 }}}, // color_inner
-        {{{ 0.337,0.502,0.761,1 }}}, // color_inner_selected
-        BND_COLOR_TEXT_SELECTED, // color_text
-        BND_COLOR_TEXT, // color_text_selected
-        38, // shade_top
-        0, // shade_down
-    },
-    // nodeTheme
-    {
-        {{{ 0.945,0.345,0,1 }}}, // nodeSelectedColor
-        {{{ 0,0,0,1 }}}, // wiresColor
-        {{{ 0.498,0.439,0.439,1 }}}, // textSelectedColor
-        {{{ 1,0.667,0.251,1 }}}, // activeNodeColor
-        {{{ 1,1,1,1 }}}, // wireSelectColor
-        {{{ 0.608,0.608,0.608,0.627 }}}, // nodeBackdropColor
-        5, // noodleCurving
-    },
+// text bounds cache; measurements are keyed by nanovg context, font, size,
+// break width and the text, which is found by its 64-bit hash. All links are
+// stored as index+1 so that a zeroed table is a valid empty cache.
+typedef struct BNDtextEntry {
+    NVGcontext *ctx;
+    unsigned long long hash;
+    int length;
+    char text[BND_TEXT_CACHE_MAX_LENGTH+1];
+    int font;
+    float size;
+    // < 0: single line measurement via nvgTextBounds()
+    float breakwidth;
+    float advance;
+    float bounds[4];
+    // next entry in the same hash bucket
+    int chain;
+    // neighbours in the recently used list
+    int prev;
+    int next;
+} BNDtextEntry;
+
+// indices of the widget themes in BNDtheme, in declaration order
+enum {
+    BND_REGULAR_THEME = 0,
+    BND_TOOL_THEME,
+    BND_RADIO_THEME,
+    BND_TEXT_FIELD_THEME,
+    BND_OPTION_THEME,
+    BND_CHOICE_THEME,
+    BND_NUMBER_FIELD_THEME,
+    BND_SLIDER_THEME,
+    BND_SCROLL_BAR_THEME,
+    BND_TOOLTIP_THEME,
+    BND_MENU_THEME,
+    BND_MENU_ITEM_THEME,
+
+    BND_WIDGET_THEME_COUNT
+};
+
+static const size_t bnd_widget_themes[BND_WIDGET_THEME_COUNT] = {
+    offsetof(BNDtheme, regularTheme),
+    offsetof(BNDtheme, toolTheme),
+    offsetof(BNDtheme, radioTheme),
+    offsetof(BNDtheme, textFieldTheme),
+    offsetof(BNDtheme, optionTheme),
+    offsetof(BNDtheme, choiceTheme),
+    offsetof(BNDtheme, numberFieldTheme),
+    offsetof(BNDtheme, sliderTheme),
+    offsetof(BNDtheme, scrollBarTheme),
+    offsetof(BNDtheme, tooltipTheme),
+    offsetof(BNDtheme, menuTheme),
+    offsetof(BNDtheme, menuItemTheme),
+};
+
+// colors of a widget theme for one widget state and flip setting
+typedef struct BNDwidgetColors {
+    // inner box gradient, as computed by bndInnerColors()
+    NVGcolor shade_top;
+    NVGcolor shade_down;
+    // slider bar gradient
+    NVGcolor item_top;
+    NVGcolor item_down;
+    // transparent outline and item colors
+    NVGcolor outline;
+    NVGcolor item;
+    // label color, as computed by bndTextColor()
+    NVGcolor text;
+} BNDwidgetColors;
+
+// a growable scratch buffer
+typedef struct BNDbuffer {
+    void *data;
+    size_t capacity;
+} BNDbuffer;
+
+struct BNDcontext {
+    BNDtheme theme;
+    // the handle to the image containing the icon sheet
+    int icon_image;
+    // the handle to the UI font
+    int font;
+
+    // text bounds cache
+    BNDtextEntry text_cache[BND_TEXT_CACHE_SIZE];
+    int text_buckets[BND_TEXT_CACHE_SIZE];
+    int text_count;
+    // most and least recently used entries
+    int text_head;
+    int text_tail;
+
+    // nonzero if level of detail reduction is enabled
+    int lod;
+    // nonzero if widget boxes are filled and outlined from one path
+    int shared_box_paths;
+
+    // widget colors precomputed from theme; see bnd_update_colors()
+    BNDwidgetColors colors[BND_WIDGET_THEME_COUNT][3][2];
+    int colors_valid;
+
+    // scratch buffers for text layout
+    NVGtextRow rows[BND_MAX_ROWS];
+    NVGglyphPosition glyphs[BND_MAX_GLYPHS];
+
+    // scratch buffer for batched wires; see bndColoredNodeWires()
+    BNDbuffer wire_keys;
+
+#ifdef BLENDISH_STATS
+    // nanovg calls since bndResetStats()
+    BNDstats stats;
+    BNDstats stats_entries[BND_MAX_STATS_ENTRIES];
+    int stats_count;
+    // entry the last call was attributed to
+    int stats_last;
+    // number of public functions being run and the outermost of them
+    int stats_depth;
+    const char *stats_function;
+#endif
+};
+
+// the initial theme; a macro so that both the theme and the default context
+// below can be initialized statically
+#define BND_DEFAULT_THEME { \
+    /* backgroundColor */ \
+    {{{ 0.447, 0.447, 0.447, 1.0 }}}, \
+    /* regularTheme */ \
+    { \
+        {{{ 0.098,0.098,0.098,1 }}}, /* color_outline */ \
+        {{{ 0.098,0.098,0.098,1 }}}, /* color_item */ \
+        {{{ 0.6,0.6,0.6,1 }}}, /* color_inner */ \
+        {{{ 0.392,0.392,0.392,1 }}}, /* color_inner_selected */ \
+        BND_COLOR_TEXT, /* color_text */ \
+        BND_COLOR_TEXT_SELECTED, /* color_text_selected */ \
+        0, /* shade_top */ \
+        0, /* shade_down */ \
+    }, \
+    /* toolTheme */ \
+    { \
+        {{{ 0.098,0.098,0.098,1 }}}, /* color_outline */ \
+        {{{ 0.098,0.098,0.098,1 }}}, /* color_item */ \
+        {{{ 0.6,0.6,0.6,1 }}}, /* color_inner */ \
+        {{{ 0.392,0.392,0.392,1 }}}, /* color_inner_selected */ \
+        BND_COLOR_TEXT, /* color_text */ \
+        BND_COLOR_TEXT_SELECTED, /* color_text_selected */ \
+        15, /* shade_top */ \
+        -15, /* shade_down */ \
+    }, \
+    /* radioTheme */ \
+    { \
+        {{{ 0,0,0,1 }}}, /* color_outline */ \
+        {{{ 1,1,1,1 }}}, /* color_item */ \
+        {{{ 0.275,0.275,0.275,1 }}}, /* color_inner */ \
+        {{{ 0.337,0.502,0.761,1 }}}, /* color_inner_selected */ \
+        BND_COLOR_TEXT_SELECTED, /* color_text */ \
+        BND_COLOR_TEXT, /* color_text_selected */ \
+        15, /* shade_top */ \
+        -15, /* shade_down */ \
+    }, \
+    /* textFieldTheme */ \
+    { \
+        {{{ 0.098,0.098,0.098,1 }}}, /* color_outline */ \
+        {{{ 0.353, 0.353, 0.353,1 }}}, /* color_item */ \
+        {{{ 0.6, 0.6, 0.6,1 }}}, /* color_inner */ \
+        {{{ 0.6, 0.6, 0.6,1 }}}, /* color_inner_selected */ \
+        BND_COLOR_TEXT, /* color_text */ \
+        BND_COLOR_TEXT_SELECTED, /* color_text_selected */ \
+        0, /* shade_top */ \
+        25, /* shade_down */ \
+    }, \
+    /* optionTheme */ \
+    { \
+        {{{ 0,0,0,1 }}}, /* color_outline */ \
+        {{{ 1,1,1,1 }}}, /* color_item */ \
+        {{{ 0.275,0.275,0.275,1 }}}, /* color_inner */ \
+        {{{ 0.275,0.275,0.275,1 }}}, /* color_inner_selected */ \
+        BND_COLOR_TEXT, /* color_text */ \
+        BND_COLOR_TEXT_SELECTED, /* color_text_selected */ \
+        15, /* shade_top */ \
+        -15, /* shade_down */ \
+    }, \
+    /* choiceTheme */ \
+    { \
+        {{{ 0,0,0,1 }}}, /* color_outline */ \
+        {{{ 1,1,1,1 }}}, /* color_item */ \
+        {{{ 0.275,0.275,0.275,1 }}}, /* color_inner */ \
+        {{{ 0.275,0.275,0.275,1 }}}, /* color_inner_selected */ \
+        BND_COLOR_TEXT_SELECTED, /* color_text */ \
+        {{{ 0.8,0.8,0.8,1 }}}, /* color_text_selected */ \
+        15, /* shade_top */ \
+        -15, /* shade_down */ \
+    }, \
+    /* numberFieldTheme */ \
+    { \
+        {{{ 0.098,0.098,0.098,1 }}}, /* color_outline */ \
+        {{{ 0.353, 0.353, 0.353,1 }}}, /* color_item */ \
+        {{{ 0.706, 0.706, 0.706,1 }}}, /* color_inner */ \
+        {{{ 0.6, 0.6, 0.6,1 }}}, /* color_inner_selected */ \
+        BND_COLOR_TEXT, /* color_text */ \
+        BND_COLOR_TEXT_SELECTED, /* color_text_selected */ \
+        -20, /* shade_top */ \
+        0, /* shade_down */ \
+    }, \
+    /* sliderTheme */ \
+    { \
+        {{{ 0.098,0.098,0.098,1 }}}, /* color_outline */ \
+        {{{ 0.502,0.502,0.502,1 }}}, /* color_item */ \
+        {{{ 0.706, 0.706, 0.706,1 }}}, /* color_inner */ \
+        {{{ 0.6, 0.6, 0.6,1 }}}, /* color_inner_selected */ \
+        BND_COLOR_TEXT, /* color_text */ \
+        BND_COLOR_TEXT_SELECTED, /* color_text_selected */ \
+        -20, /* shade_top */ \
+        0, /* shade_down */ \
+    }, \
+    /* scrollBarTheme */ \
+    { \
+        {{{ 0.196,0.196,0.196,1 }}}, /* color_outline */ \
+        {{{ 0.502,0.502,0.502,1 }}}, /* color_item */ \
+        {{{ 0.314, 0.314, 0.314,0.706 }}}, /* color_inner */ \
+        {{{ 0.392, 0.392, 0.392,0.706 }}}, /* color_inner_selected */ \
+        BND_COLOR_TEXT, /* color_text */ \
+        BND_COLOR_TEXT_SELECTED, /* color_text_selected */ \
+        5, /* shade_top */ \
+        -5, /* shade_down */ \
+    }, \
+    /* tooltipTheme */ \
+    { \
+        {{{ 0,0,0,1 }}}, /* color_outline */ \
+        {{{ 0.392,0.392,0.392,1 }}}, /* color_item */ \
+        {{{ 0.098, 0.098, 0.098, 0.902 }}}, /* color_inner */ \
+        {{{ 0.176, 0.176, 0.176, 0.902 }}}, /* color_inner_selected */ \
+        {{{ 0.627, 0.627, 0.627, 1 }}}, /* color_text */ \
+        BND_COLOR_TEXT_SELECTED, /* color_text_selected */ \
+        0, /* shade_top */ \
+        0, /* shade_down */ \
+    }, \
+    /* menuTheme */ \
+    { \
+        {{{ 0,0,0,1 }}}, /* color_outline */ \
+        {{{ 0.392,0.392,0.392,1 }}}, /* color_item */ \
+        {{{ 0.098, 0.098, 0.098, 0.902 }}}, /* color_inner */ \
+        {{{ 0.176, 0.176, 0.176, 0.902 }}}, /* color_inner_selected */ \
+        {{{ 0.627, 0.627, 0.627, 1 }}}, /* color_text */ \
+        BND_COLOR_TEXT_SELECTED, /* color_text_selected */ \
+        0, /* shade_top */ \
+        0, /* shade_down */ \
+    }, \
+    /* menuItemTheme */ \
+    { \
+        {{{ 0,0,0,1 }}}, /* color_outline */ \
+        {{{ 0.675,0.675,0.675,0.502 }}}, /* color_item */ \
+        {{{ 0,0,0,0 }}}, /* color_inner */ \
+        {{{ 0.337,0.502,0.761,1 }}}, /* color_inner_selected */ \
+        BND_COLOR_TEXT_SELECTED, /* color_text */ \
+        BND_COLOR_TEXT, /* color_text_selected */ \
+        38, /* shade_top */ \
+        0, /* shade_down */ \
+    }, \
+    /* nodeTheme */ \
+    { \
+        {{{ 0.945,0.345,0,1 }}}, /* nodeSelectedColor */ \
+        {{{ 0,0,0,1 }}}, /* wiresColor */ \
+        {{{ 0.498,0.439,0.439,1 }}}, /* textSelectedColor */ \
+        {{{ 1,0.667,0.251,1 }}}, /* activeNodeColor */ \
+        {{{ 1,1,1,1 }}}, /* wireSelectColor */ \
+        {{{ 0.608,0.608,0.608,0.627 }}}, /* nodeBackdropColor */ \
+        5, /* noodleCurving */ \
+    }, \
+}
+
+static const BNDtheme bnd_default_theme = BND_DEFAULT_THEME;
+
+// the context used by threads that have not selected one
+static BNDcontext bnd_default_context = {
+    BND_DEFAULT_THEME, // theme
+    -1, // icon_image
+    -1, // font
 };
 
+// the context selected by the calling thread, NULL if none
+static BND_THREAD_LOCAL BNDcontext *bnd_current_context = NULL;
+
+// the current context of the calling thread
+#define bnd_context (bnd_current_context?bnd_current_context:&bnd_default_context)
+
+////////////////////////////////////////////////////////////////////////////////
+
+BNDcontext *bndCreateContext() {
+    BNDcontext *ctx = (BNDcontext *)malloc(sizeof(BNDcontext));
+    if (!ctx) return NULL;
+    memset(ctx, 0, sizeof(BNDcontext));
+    // fonts and images belong to an NVGcontext, so a new context starts
+    // without them even if the default context has some set
+    ctx->theme = bnd_default_theme;
+    ctx->icon_image = -1;
+    ctx->font = -1;
+    return ctx;
+}
+
+void bndDestroyContext(BNDcontext *ctx) {
+    if (!ctx || (ctx == &bnd_default_context)) return;
+    if (bnd_current_context == ctx)
+        bndMakeCurrent(NULL);
+    free(ctx->wire_keys.data);
+    free(ctx);
+}
+
+void bndMakeCurrent(BNDcontext *ctx) {
+    bnd_current_context = ctx;
+}
+
+BNDcontext *bndGetContext() {
+    return bnd_context;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef BLENDISH_STATS
+
+void bndResetStats() {
+    BNDcontext *bnd = bnd_context;
+    memset(&bnd->stats, 0, sizeof(BNDstats));
+    bnd->stats_count = 0;
+    bnd->stats_last = 0;
+}
+
+const BNDstats *bndGetStats() {
+    return &bnd_context->stats;
+}
+
+int bndGetStatsCount() {
+    return bnd_context->stats_count;
+}
+
+const BNDstats *bndGetStatsEntry(int index) {
+    if ((index < 0) || (index >= bnd_context->stats_count)) return NULL;
+    return &bnd_context->stats_entries[index];
+}
+
+// called on entry and exit of every public function that draws, so that
+// nanovg calls made by helpers and nested public functions are attributed
+// to the public function the application called
+static void bnd_stats_enter(const char *function) {
+    BNDcontext *bnd = bnd_context;
+    if (!bnd->stats_depth++)
+        bnd->stats_function = function;
+}
+
+static void bnd_stats_exit() {
+    bnd_context->stats_depth--;
+}
+
+#define BND_STATS_ENTER() bnd_stats_enter(__func__)
+#define BND_STATS_EXIT() bnd_stats_exit()
+
+// count one nanovg call made by function; function is always a __func__,
+// so entries can be told apart by address
+static void bnd_stat(const char *function, BNDstat stat) {
+    BNDcontext *bnd = bnd_context;
+    BNDstats *entry;
+    int i = bnd->stats_last;
+    if (bnd->stats_depth)
+        function = bnd->stats_function;
+    bnd->stats.counts[stat]++;
+    if ((i >= bnd->stats_count)
+        || (bnd->stats_entries[i].function != function)) {
+        for (i = 0; i < bnd->stats_count; ++i) {
+            if (bnd->stats_entries[i].function == function) break;
+        }
+        if (i == bnd->stats_count) {
+            if (i == BND_MAX_STATS_ENTRIES) return;
+            entry = &bnd->stats_entries[bnd->stats_count++];
+            memset(entry, 0, sizeof(BNDstats));
+            entry->function = function;
+        }
+        bnd->stats_last = i;
+    }
+    bnd->stats_entries[i].counts[stat]++;
+}
+
+// from here on, every counted nanovg call made by blendish goes through
+// bnd_stat() first
+#define BND_COUNTED(STAT, CALL) (bnd_stat(__func__, STAT), CALL)
+
+#define nvgBeginPath(...) \
+    BND_COUNTED(BND_STAT_PATHS, nvgBeginPath(__VA_ARGS__))
+#define nvgFill(...) \
+    BND_COUNTED(BND_STAT_FILLS, nvgFill(__VA_ARGS__))
+#define nvgStroke(...) \
+    BND_COUNTED(BND_STAT_STROKES, nvgStroke(__VA_ARGS__))
+#define nvgFillColor(...) \
+    BND_COUNTED(BND_STAT_COLOR_PAINTS, nvgFillColor(__VA_ARGS__))
+#define nvgStrokeColor(...) \
+    BND_COUNTED(BND_STAT_COLOR_PAINTS, nvgStrokeColor(__VA_ARGS__))
+#define nvgLinearGradient(...) \
+    BND_COUNTED(BND_STAT_LINEAR_GRADIENTS, nvgLinearGradient(__VA_ARGS__))
+#define nvgBoxGradient(...) \
+    BND_COUNTED(BND_STAT_BOX_GRADIENTS, nvgBoxGradient(__VA_ARGS__))
+#define nvgImagePattern(...) \
+    BND_COUNTED(BND_STAT_IMAGE_PATTERNS, nvgImagePattern(__VA_ARGS__))
+#define nvgScissor(...) \
+    BND_COUNTED(BND_STAT_SCISSORS, nvgScissor(__VA_ARGS__))
+#define nvgResetScissor(...) \
+    BND_COUNTED(BND_STAT_SCISSORS, nvgResetScissor(__VA_ARGS__))
+#define nvgText(...) \
+    BND_COUNTED(BND_STAT_TEXT_RUNS, nvgText(__VA_ARGS__))
+#define nvgTextBox(...) \
+    BND_COUNTED(BND_STAT_TEXT_RUNS, nvgTextBox(__VA_ARGS__))
+#define nvgTextBounds(...) \
+    BND_COUNTED(BND_STAT_TEXT_MEASUREMENTS, nvgTextBounds(__VA_ARGS__))
+#define nvgTextBoxBounds(...) \
+    BND_COUNTED(BND_STAT_TEXT_MEASUREMENTS, nvgTextBoxBounds(__VA_ARGS__))
+#define nvgTextBreakLines(...) \
+    BND_COUNTED(BND_STAT_TEXT_MEASUREMENTS, nvgTextBreakLines(__VA_ARGS__))
+#define nvgTextGlyphPositions(...) BND_COUNTED(BND_STAT_TEXT_MEASUREMENTS, \
+    nvgTextGlyphPositions(__VA_ARGS__))
+#define nvgTextMetrics(...) \
+    BND_COUNTED(BND_STAT_TEXT_MEASUREMENTS, nvgTextMetrics(__VA_ARGS__))
+#define nvgStrokeWidth(...) \
+    BND_COUNTED(BND_STAT_STATE_CHANGES, nvgStrokeWidth(__VA_ARGS__))
+#define nvgLineCap(...) \
+    BND_COUNTED(BND_STAT_STATE_CHANGES, nvgLineCap(__VA_ARGS__))
+#define nvgLineJoin(...) \
+    BND_COUNTED(BND_STAT_STATE_CHANGES, nvgLineJoin(__VA_ARGS__))
+#define nvgFontSize(...) \
+    BND_COUNTED(BND_STAT_STATE_CHANGES, nvgFontSize(__VA_ARGS__))
+#define nvgFontFaceId(...) \
+    BND_COUNTED(BND_STAT_STATE_CHANGES, nvgFontFaceId(__VA_ARGS__))
+#define nvgFontBlur(...) \
+    BND_COUNTED(BND_STAT_STATE_CHANGES, nvgFontBlur(__VA_ARGS__))
+#define nvgTextAlign(...) \
+    BND_COUNTED(BND_STAT_STATE_CHANGES, nvgTextAlign(__VA_ARGS__))
+#define nvgTransform(...) \
+    BND_COUNTED(BND_STAT_STATE_CHANGES, nvgTransform(__VA_ARGS__))
+#define nvgResetTransform(...) \
+    BND_COUNTED(BND_STAT_STATE_CHANGES, nvgResetTransform(__VA_ARGS__))
+#define nvgSave(...) \
+    BND_COUNTED(BND_STAT_STATE_CHANGES, nvgSave(__VA_ARGS__))
+#define nvgRestore(...) \
+    BND_COUNTED(BND_STAT_STATE_CHANGES, nvgRestore(__VA_ARGS__))
+
+#else
+
+#define BND_STATS_ENTER()
+#define BND_STATS_EXIT()
+
+#endif // BLENDISH_STATS
+
+// leaves a public function that called BND_STATS_ENTER()
+#define BND_STATS_RETURN(...) \
+    do { BND_STATS_EXIT(); return __VA_ARGS__; } while (0)
+
 ////////////////////////////////////////////////////////////////////////////////
 
+static void bnd_update_colors(BNDcontext *ctx) {
+    int i, state, flip;
+    for (i = 0; i < BND_WIDGET_THEME_COUNT; ++i) {
+        const BNDwidgetTheme *theme = (const BNDwidgetTheme *)
+            ((const char *)&ctx->theme + bnd_widget_themes[i]);
+        for (state = BND_DEFAULT; state <= BND_ACTIVE; ++state) {
+            for (flip = 0; flip < 2; ++flip) {
+                BNDwidgetColors *c = &ctx->colors[i][state][flip];
+                bndInnerColors(&c->shade_top, &c->shade_down, theme,
+                    (BNDwidgetState)state, flip);
+                if (state == BND_ACTIVE) {
+                    c->item_top = bndOffsetColor(theme->itemColor,
+                        theme->shadeTop);
+                    c->item_down = bndOffsetColor(theme->itemColor,
+                        theme->shadeDown);
+                } else {
+                    c->item_top = bndOffsetColor(theme->itemColor,
+                        theme->shadeDown);
+                    c->item_down = bndOffsetColor(theme->itemColor,
+                        theme->shadeTop);
+                }
+                c->outline = bndTransparent(theme->outlineColor);
+                c->item = bndTransparent(theme->itemColor);
+                c->text = bndTextColor(theme, (BNDwidgetState)state);
+            }
+        }
+    }
+    ctx->colors_valid = 1;
+}
+
+// returns the precomputed colors for a widget theme index and state
+static const BNDwidgetColors *bnd_colors(int theme, BNDwidgetState state,
+    int flipActive) {
+    if (!bnd_context->colors_valid)
+        bnd_update_colors(bnd_context);
+    if ((unsigned)state > BND_ACTIVE)
+        state = BND_DEFAULT;
+    return &bnd_context->colors[theme][state][flipActive?1:0];
+}
+
 void bndSetTheme(BNDtheme theme) {
-    bnd_theme = theme;
+    bnd_context->theme = theme;
+    bnd_update_colors(bnd_context);
 }
 
 const BNDtheme *bndGetTheme() {
-    return &bnd_theme;
+    return &bnd_context->theme;
 }
 
-// the handle to the image containing the icon sheet
-static int bnd_icon_image = -1;
-
 void bndSetIconImage(int image) {
-    bnd_icon_image = image;
+    bnd_context->icon_image = image;
 }
 
-// the handle to the UI font
-static int bnd_font = -1;
-
 void bndSetFont(int font) {
-    bnd_font = font;
+    bnd_context->font = font;
+    bndClearTextCache();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+void bndClearTextCache() {
+    memset(bnd_context->text_buckets, 0, sizeof(bnd_context->text_buckets));
+    bnd_context->text_count = 0;
+    bnd_context->text_head = 0;
+    bnd_context->text_tail = 0;
+}
+
+static unsigned long long bnd_text_hash(const char *text, int *length) {
+    // FNV-1a
+    unsigned long long hash = 14695981039346656037ULL;
+    const char *s = text;
+    while (*s) {
+        hash ^= (unsigned char)*s++;
+        hash *= 1099511628211ULL;
+    }
+    *length = (int)(s - text);
+    return hash;
+}
+
+static void bnd_text_unlink(int i) {
+    BNDtextEntry *e = &bnd_context->text_cache[i-1];
+    if (e->prev) bnd_context->text_cache[e->prev-1].next = e->next;
+    else bnd_context->text_head = e->next;
+    if (e->next) bnd_context->text_cache[e->next-1].prev = e->prev;
+    else bnd_context->text_tail = e->prev;
+}
+
+static void bnd_text_push_front(int i) {
+    BNDtextEntry *e = &bnd_context->text_cache[i-1];
+    e->prev = 0;
+    e->next = bnd_context->text_head;
+    if (bnd_context->text_head) bnd_context->text_cache[bnd_context->text_head-1].prev = i;
+    else bnd_context->text_tail = i;
+    bnd_context->text_head = i;
+}
+
+// measures text without the cache; see bnd_text_bounds()
+static float bnd_measure_text(NVGcontext *ctx, float size, float breakwidth,
+    const char *text, float *bounds) {
+    float advance;
+    nvgSave(ctx);
+    nvgFontSize(ctx, size);
+    nvgTextAlign(ctx, NVG_ALIGN_LEFT|NVG_ALIGN_BASELINE);
+    if (breakwidth < 0) {
+        advance = nvgTextBounds(ctx, 1, 1, text, NULL, bounds);
+    } else {
+        nvgTextBoxBounds(ctx, 1, 1, breakwidth, text, NULL, bounds);
+        advance = bounds[2] - bounds[0];
+    }
+    nvgRestore(ctx);
+    return advance;
+}
+
+// returns the advance of text at the given font size, as nvgTextBounds()
+// would from position (1,1), and stores its bounds in bounds. If breakwidth
+// is >= 0, bounds are measured with nvgTextBoxBounds() instead and the
+// returned advance is the width of the box.
+// The current font face must be bnd_context->font.
+static float bnd_text_bounds(NVGcontext *ctx, float size, float breakwidth,
+    const char *text, float *bounds) {
+    int length;
+    unsigned long long hash = bnd_text_hash(text, &length);
+    int bucket = (int)(hash % BND_TEXT_CACHE_SIZE);
+    int i = bnd_context->text_buckets[bucket];
+    BNDtextEntry *e;
+    if (length > BND_TEXT_CACHE_MAX_LENGTH) {
+        // too long to be kept
+        float text_bounds[4];
+        float advance = bnd_measure_text(ctx, size, breakwidth, text,
+            text_bounds);
+        if (bounds)
+            memcpy(bounds, text_bounds, sizeof(text_bounds));
+        return advance;
+    }
+    while (i) {
+        e = &bnd_context->text_cache[i-1];
+        if ((e->hash == hash) && (e->length == length)
+            && (e->ctx == ctx) && (e->font == bnd_context->font)
+            && (e->size == size) && (e->breakwidth == breakwidth)
+            && !memcmp(e->text, text, length)) {
+            if (bnd_context->text_head != i) {
+                bnd_text_unlink(i);
+                bnd_text_push_front(i);
+            }
+            if (bounds)
+                memcpy(bounds, e->bounds, sizeof(e->bounds));
+            return e->advance;
+        }
+        i = e->chain;
+    }
+
+    if (bnd_context->text_count < BND_TEXT_CACHE_SIZE) {
+        i = ++bnd_context->text_count;
+    } else {
+        // evict the least recently used entry
+        int *link;
+        i = bnd_context->text_tail;
+        e = &bnd_context->text_cache[i-1];
+        link = &bnd_context->text_buckets[(int)(e->hash % BND_TEXT_CACHE_SIZE)];
+        while (*link != i)
+            link = &bnd_context->text_cache[*link-1].chain;
+        *link = e->chain;
+        bnd_text_unlink(i);
+    }
+    e = &bnd_context->text_cache[i-1];
+    e->ctx = ctx;
+    e->hash = hash;
+    e->length = length;
+    memcpy(e->text, text, length+1);
+    e->font = bnd_context->font;
+    e->size = size;
+    e->breakwidth = breakwidth;
+
+    e->advance = bnd_measure_text(ctx, size, breakwidth, text, e->bounds);
+
+    e->chain = bnd_context->text_buckets[bucket];
+    bnd_context->text_buckets[bucket] = i;
+    bnd_text_push_front(i);
+    if (bounds)
+        memcpy(bounds, e->bounds, sizeof(e->bounds));
+    return e->advance;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// makes sure the buffer holds at least size bytes; returns its data or NULL
+static void *bnd_reserve(BNDbuffer *buffer, size_t size) {
+    if (size > buffer->capacity) {
+        size_t capacity = buffer->capacity?buffer->capacity:256;
+        void *data;
+        while (capacity < size)
+            capacity *= 2;
+        data = realloc(buffer->data, capacity);
+        if (!data) return NULL;
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    return buffer->data;
+}
+
+// returns the zoom level of the current transform
+static float bnd_transform_scale(NVGcontext *ctx) {
+    float t[6];
+    nvgCurrentTransform(ctx, t);
+    return sqrtf(fabsf(t[0]*t[3] - t[1]*t[2]));
+}
+
+// levels of detail, from full detail to plain rectangles
+enum {
+    BND_LOD_FULL = 0,
+    // no text and icons
+    BND_LOD_NO_TEXT,
+    // additionally no gradients and drop shadows
+    BND_LOD_NO_GRADIENTS,
+    // additionally no rounded corners and outlines
+    BND_LOD_NO_CORNERS,
+};
+
+void bndSetLevelOfDetail(int enabled) {
+    bnd_context->lod = enabled;
+}
+
+// returns the level of detail for the current transform
+static int bnd_lod(NVGcontext *ctx) {
+    float scale;
+    if (!bnd_context->lod) return BND_LOD_FULL;
+    scale = bnd_transform_scale(ctx);
+    if (scale < BND_LOD_CORNER_SCALE) return BND_LOD_NO_CORNERS;
+    if (scale < BND_LOD_GRADIENT_SCALE) return BND_LOD_NO_GRADIENTS;
+    if (scale < BND_LOD_TEXT_SCALE) return BND_LOD_NO_TEXT;
+    return BND_LOD_FULL;
+}
+
+// sets the fill of an inner box; the gradient is horizontal if the box is
+// higher than wide, and replaced by a flat color at low levels of detail
+static void bnd_inner_fill(NVGcontext *ctx, int lod,
+    float x, float y, float w, float h,
+    NVGcolor shade_top, NVGcolor shade_down) {
+    if (lod >= BND_LOD_NO_GRADIENTS) {
+        nvgFillColor(ctx, nvgLerpRGBA(shade_top, shade_down, 0.5f));
+    } else {
+        nvgFillPaint(ctx,((h-2)>w)?
+            nvgLinearGradient(ctx,x,y,x+w,y,shade_top,shade_down):
+            nvgLinearGradient(ctx,x,y,x,y+h,shade_top,shade_down));
+    }
+}
+
+void bndSetSharedBoxPaths(int enabled) {
+    bnd_context->shared_box_paths = enabled;
+}
+
+// begins the path of the inner part of a widget box. With shared box paths
+// and outlines enabled, the outline geometry is used instead, so that the
+// outline can be stroked from the same path; returns nonzero in that case.
+static int bnd_inner_box_path(NVGcontext *ctx, int lod,
+    float x, float y, float w, float h,
+    float cr0, float cr1, float cr2, float cr3) {
+    nvgBeginPath(ctx);
+    if (bnd_context->shared_box_paths && (lod < BND_LOD_NO_CORNERS)) {
+        bndRoundedBox(ctx,x+0.5f,y+0.5f,w-1,h-2,cr0,cr1,cr2,cr3);
+        return 1;
+    }
+    bndRoundedBox(ctx,x+1,y+1,w-2,h-3,bnd_fmaxf(0,cr0-1),
+        bnd_fmaxf(0,cr1-1),bnd_fmaxf(0,cr2-1),bnd_fmaxf(0,cr3-1));
+    return 0;
+}
+
+// strokes the outline of a widget box; if shared is nonzero, the current
+// path from bnd_inner_box_path() is reused
+static void bnd_outline_box_stroke(NVGcontext *ctx, int lod, int shared,
+    float x, float y, float w, float h,
+    float cr0, float cr1, float cr2, float cr3, NVGcolor color) {
+    if (lod >= BND_LOD_NO_CORNERS) return;
+    if (!shared) {
+        nvgBeginPath(ctx);
+        bndRoundedBox(ctx,x+0.5f,y+0.5f,w-1,h-2,cr0,cr1,cr2,cr3);
+    }
+    nvgStrokeColor(ctx,color);
+    nvgStrokeWidth(ctx,1);
+    nvgStroke(ctx);
+}
+
 void bndLabel(NVGcontext *ctx,
     float x, float y, float w, float h, int iconid, const char *label) {
+    BND_STATS_ENTER();
     bndIconLabelValue(ctx,x,y,w,h,iconid,
-        bnd_theme.regularTheme.textColor, BND_LEFT,
+        bnd_context->theme.regularTheme.textColor, BND_LEFT,
         BND_LABEL_FONT_SIZE, label, NULL);
+    BND_STATS_EXIT();
 }
 
 void bndToolButton(NVGcontext *ctx,
     float x, float y, float w, float h, int flags, BNDwidgetState state,
     int iconid, const char *label) {
     float cr[4];
-    NVGcolor shade_top, shade_down;
+    const BNDwidgetColors *colors = bnd_colors(BND_TOOL_THEME, state, 1);
+    BND_STATS_ENTER();
 
     bndSelectCorners(cr, BND_TOOL_RADIUS, flags);
     bndBevelInset(ctx,x,y,w,h,cr[2],cr[3]);
-    bndInnerColors(&shade_top, &shade_down, &bnd_theme.toolTheme, state, 1);
-    bndInnerBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3], shade_top, shade_down);
-    bndOutlineBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3],
-        bndTransparent(bnd_theme.toolTheme.outlineColor));
+    bndInnerOutlineBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3],
+        colors->shade_top, colors->shade_down, colors->outline);
     bndIconLabelValue(ctx,x,y,w,h,iconid,
-        bndTextColor(&bnd_theme.toolTheme, state), BND_CENTER,
+        colors->text, BND_CENTER,
         BND_LABEL_FONT_SIZE, label, NULL);
+    BND_STATS_EXIT();
 }
 
 void bndRadioButton(NVGcontext *ctx,
     float x, float y, float w, float h, int flags, BNDwidgetState state,
     int iconid, const char *label) {
     float cr[4];
-    NVGcolor shade_top, shade_down;
+    const BNDwidgetColors *colors = bnd_colors(BND_RADIO_THEME, state, 1);
+    BND_STATS_ENTER();
 
     bndSelectCorners(cr, BND_OPTION_RADIUS, flags);
     bndBevelInset(ctx,x,y,w,h,cr[2],cr[3]);
-    bndInnerColors(&shade_top, &shade_down, &bnd_theme.radioTheme, state, 1);
-    bndInnerBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3], shade_top, shade_down);
-    bndOutlineBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3],
-        bndTransparent(bnd_theme.radioTheme.outlineColor));
+    bndInnerOutlineBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3],
+        colors->shade_top, colors->shade_down, colors->outline);
     bndIconLabelValue(ctx,x,y,w,h,iconid,
-        bndTextColor(&bnd_theme.radioTheme, state), BND_CENTER,
+        colors->text, BND_CENTER,
         BND_LABEL_FONT_SIZE, label, NULL);
+    BND_STATS_EXIT();
 }
 
 int bndTextFieldTextPosition(NVGcontext *ctx, float x, float y, float w, float h,
     int iconid, const char *text, int px, int py) {
-    return bndIconLabelTextPosition(ctx, x, y, w, h,
+    int p;
+    BND_STATS_ENTER();
+    p = bndIconLabelTextPosition(ctx, x, y, w, h,
         iconid, BND_LABEL_FONT_SIZE, text, px, py);
+    BND_STATS_RETURN(p);
 }
 
 void bndTextField(NVGcontext *ctx,
     float x, float y, float w, float h, int flags, BNDwidgetState state,
     int iconid, const char *text, int cbegin, int cend) {
     float cr[4];
-    NVGcolor shade_top, shade_down;
+    const BNDwidgetColors *colors = bnd_colors(BND_TEXT_FIELD_THEME, state, 0);
+    BND_STATS_ENTER();
 
     bndSelectCorners(cr, BND_TEXT_RADIUS, flags);
     bndBevelInset(ctx,x,y,w,h,cr[2],cr[3]);
-    bndInnerColors(&shade_top, &shade_down, &bnd_theme.textFieldTheme, state, 0);
-    bndInnerBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3], shade_top, shade_down);
-    bndOutlineBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3],
-        bndTransparent(bnd_theme.textFieldTheme.outlineColor));
+    bndInnerOutlineBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3],
+        colors->shade_top, colors->shade_down, colors->outline);
     if (state != BND_ACTIVE) {
         cend = -1;
     }
     bndIconLabelCaret(ctx,x,y,w,h,iconid,
-        bndTextColor(&bnd_theme.textFieldTheme, state), BND_LABEL_FONT_SIZE,
-        text, bnd_theme.textFieldTheme.itemColor, cbegin, cend);
+        colors->text, BND_LABEL_FONT_SIZE,
+        text, bnd_context->theme.textFieldTheme.itemColor, cbegin, cend);
+    BND_STATS_EXIT();
 }
 
 void bndOptionButton(NVGcontext *ctx,
     float x, float y, float w, float h, BNDwidgetState state,
     const char *label) {
     float ox, oy;
-    NVGcolor shade_top, shade_down;
+    const BNDwidgetColors *colors = bnd_colors(BND_OPTION_THEME, state, 1);
+    BND_STATS_ENTER();
 
     ox = x;
     oy = y+h-BND_OPTION_HEIGHT-3;
@@ -329,212 +913,244 @@ void bndOptionButton(NVGcontext *ctx,
     bndBevelInset(ctx,ox,oy,
         BND_OPTION_WIDTH,BND_OPTION_HEIGHT,
         BND_OPTION_RADIUS,BND_OPTION_RADIUS);
-    bndInnerColors(&shade_top, &shade_down, &bnd_theme.optionTheme, state, 1);
-    bndInnerBox(ctx,ox,oy,
+    bndInnerOutlineBox(ctx,ox,oy,
         BND_OPTION_WIDTH,BND_OPTION_HEIGHT,
         BND_OPTION_RADIUS,BND_OPTION_RADIUS,BND_OPTION_RADIUS,BND_OPTION_RADIUS,
-        shade_top, shade_down);
-    bndOutlineBox(ctx,ox,oy,
-        BND_OPTION_WIDTH,BND_OPTION_HEIGHT,
-        BND_OPTION_RADIUS,BND_OPTION_RADIUS,BND_OPTION_RADIUS,BND_OPTION_RADIUS,
-        bndTransparent(bnd_theme.optionTheme.outlineColor));
+        colors->shade_top, colors->shade_down, colors->outline);
     if (state == BND_ACTIVE) {
-        bndCheck(ctx,ox,oy, bndTransparent(bnd_theme.optionTheme.itemColor));
+        bndCheck(ctx,ox,oy, colors->item);
     }
     bndIconLabelValue(ctx,x+12,y,w-12,h,-1,
-        bndTextColor(&bnd_theme.optionTheme, state), BND_LEFT,
+        colors->text, BND_LEFT,
         BND_LABEL_FONT_SIZE, label, NULL);
+    BND_STATS_EXIT();
 }
 
 void bndChoiceButton(NVGcontext *ctx,
     float x, float y, float w, float h, int flags, BNDwidgetState state,
     int iconid, const char *label) {
     float cr[4];
-    NVGcolor shade_top, shade_down;
+    const BNDwidgetColors *colors = bnd_colors(BND_CHOICE_THEME, state, 1);
+    BND_STATS_ENTER();
 
     bndSelectCorners(cr, BND_OPTION_RADIUS, flags);
     bndBevelInset(ctx,x,y,w,h,cr[2],cr[3]);
-    bndInnerColors(&shade_top, &shade_down, &bnd_theme.choiceTheme, state, 1);
-    bndInnerBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3], shade_top, shade_down);
-    bndOutlineBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3],
-        bndTransparent(bnd_theme.choiceTheme.outlineColor));
+    bndInnerOutlineBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3],
+        colors->shade_top, colors->shade_down, colors->outline);
     bndIconLabelValue(ctx,x,y,w,h,iconid,
-        bndTextColor(&bnd_theme.choiceTheme, state), BND_LEFT,
+        colors->text, BND_LEFT,
         BND_LABEL_FONT_SIZE, label, NULL);
     bndUpDownArrow(ctx,x+w-10,y+10,5,
-        bndTransparent(bnd_theme.choiceTheme.itemColor));
+        colors->item);
+    BND_STATS_EXIT();
 }
 
 void bndColorButton(NVGcontext *ctx,
     float x, float y, float w, float h, int flags, NVGcolor color) {
     float cr[4];
+    BND_STATS_ENTER();
     bndSelectCorners(cr, BND_TOOL_RADIUS, flags);
     bndBevelInset(ctx,x,y,w,h,cr[2],cr[3]);
-    bndInnerBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3], color, color);
-    bndOutlineBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3],
-        bndTransparent(bnd_theme.toolTheme.outlineColor));
+    bndInnerOutlineBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3], color, color,
+        bnd_colors(BND_TOOL_THEME, BND_DEFAULT, 0)->outline);
+    BND_STATS_EXIT();
 }
 
 void bndNumberField(NVGcontext *ctx,
     float x, float y, float w, float h, int flags, BNDwidgetState state,
     const char *label, const char *value) {
     float cr[4];
-    NVGcolor shade_top, shade_down;
+    const BNDwidgetColors *colors = bnd_colors(BND_NUMBER_FIELD_THEME, state, 0);
+    BND_STATS_ENTER();
 
     bndSelectCorners(cr, BND_NUMBER_RADIUS, flags);
     bndBevelInset(ctx,x,y,w,h,cr[2],cr[3]);
-    bndInnerColors(&shade_top, &shade_down, &bnd_theme.numberFieldTheme, state, 0);
-    bndInnerBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3], shade_top, shade_down);
-    bndOutlineBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3],
-        bndTransparent(bnd_theme.numberFieldTheme.outlineColor));
+    bndInnerOutlineBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3],
+        colors->shade_top, colors->shade_down, colors->outline);
     bndIconLabelValue(ctx,x,y,w,h,-1,
-        bndTextColor(&bnd_theme.numberFieldTheme, state), BND_CENTER,
+        colors->text, BND_CENTER,
         BND_LABEL_FONT_SIZE, label, value);
     bndArrow(ctx,x+8,y+10,-BND_NUMBER_ARROW_SIZE,
-        bndTransparent(bnd_theme.numberFieldTheme.itemColor));
+        colors->item);
     bndArrow(ctx,x+w-8,y+10,BND_NUMBER_ARROW_SIZE,
-        bndTransparent(bnd_theme.numberFieldTheme.itemColor));
+        colors->item);
+    BND_STATS_EXIT();
 }
 
 void bndSlider(NVGcontext *ctx,
     float x, float y, float w, float h, int flags, BNDwidgetState state,
     float progress, const char *label, const char *value) {
     float cr[4];
-    NVGcolor shade_top, shade_down;
+    const BNDwidgetColors *colors = bnd_colors(BND_SLIDER_THEME, state, 0);
+    BND_STATS_ENTER();
 
     bndSelectCorners(cr, BND_NUMBER_RADIUS, flags);
     bndBevelInset(ctx,x,y,w,h,cr[2],cr[3]);
-    bndInnerColors(&shade_top, &shade_down, &bnd_theme.sliderTheme, state, 0);
-    bndInnerBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3], shade_top, shade_down);
+    // the inner box path is built once and reused for both fills
+    int lod = bnd_lod(ctx);
+    int shared = bnd_inner_box_path(ctx,lod,x,y,w,h,cr[0],cr[1],cr[2],cr[3]);
+    bnd_inner_fill(ctx,lod,x,y,w,h,colors->shade_top,colors->shade_down);
+    nvgFill(ctx);
 
-    if (state == BND_ACTIVE) {
-        shade_top = bndOffsetColor(
-            bnd_theme.sliderTheme.itemColor, bnd_theme.sliderTheme.shadeTop);
-        shade_down = bndOffsetColor(
-            bnd_theme.sliderTheme.itemColor, bnd_theme.sliderTheme.shadeDown);
-    } else {
-        shade_top = bndOffsetColor(
-            bnd_theme.sliderTheme.itemColor, bnd_theme.sliderTheme.shadeDown);
-        shade_down = bndOffsetColor(
-            bnd_theme.sliderTheme.itemColor, bnd_theme.sliderTheme.shadeTop);
-    }
     nvgScissor(ctx,x,y,8+(w-8)*bnd_clamp(progress,0,1),h);
-    bndInnerBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3], shade_top, shade_down);
+    bnd_inner_fill(ctx,lod,x,y,w,h,colors->item_top,colors->item_down);
+    nvgFill(ctx);
     nvgResetScissor(ctx);
 
-    bndOutlineBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3],
-        bndTransparent(bnd_theme.sliderTheme.outlineColor));
+    bnd_outline_box_stroke(ctx,lod,shared,x,y,w,h,cr[0],cr[1],cr[2],cr[3],
+        colors->outline);
     bndIconLabelValue(ctx,x,y,w,h,-1,
-        bndTextColor(&bnd_theme.sliderTheme, state), BND_CENTER,
+        colors->text, BND_CENTER,
         BND_LABEL_FONT_SIZE, label, value);
+    BND_STATS_EXIT();
 }
 
 void bndScrollBar(NVGcontext *ctx,
     float x, float y, float w, float h, BNDwidgetState state,
     float offset, float size) {
+    const BNDwidgetTheme *theme = &bnd_context->theme.scrollBarTheme;
+    BND_STATS_ENTER();
 
     bndBevelInset(ctx,x,y,w,h,
         BND_SCROLLBAR_RADIUS, BND_SCROLLBAR_RADIUS);
-    bndInnerBox(ctx,x,y,w,h,
-        BND_SCROLLBAR_RADIUS,BND_SCROLLBAR_RADIUS,
-        BND_SCROLLBAR_RADIUS,BND_SCROLLBAR_RADIUS,
-        bndOffsetColor(
-            bnd_theme.scrollBarTheme.innerColor, 3*bnd_theme.scrollBarTheme.shadeDown),
-        bndOffsetColor(
-            bnd_theme.scrollBarTheme.innerColor, 3*bnd_theme.scrollBarTheme.shadeTop));
-    bndOutlineBox(ctx,x,y,w,h,
+    bndInnerOutlineBox(ctx,x,y,w,h,
         BND_SCROLLBAR_RADIUS,BND_SCROLLBAR_RADIUS,
         BND_SCROLLBAR_RADIUS,BND_SCROLLBAR_RADIUS,
-        bndTransparent(bnd_theme.scrollBarTheme.outlineColor));
+        bndOffsetColor(theme->innerColor, 3*theme->shadeDown),
+        bndOffsetColor(theme->innerColor, 3*theme->shadeTop),
+        bnd_colors(BND_SCROLL_BAR_THEME, BND_DEFAULT, 0)->outline);
 
-    NVGcolor itemColor = bndOffsetColor(
-        bnd_theme.scrollBarTheme.itemColor,
+    NVGcolor itemColor = bndOffsetColor(theme->itemColor,
         (state == BND_ACTIVE)?BND_SCROLLBAR_ACTIVE_SHADE:0);
 
     bndScrollHandleRect(&x,&y,&w,&h,offset,size);
 
-    bndInnerBox(ctx,x,y,w,h,
-        BND_SCROLLBAR_RADIUS,BND_SCROLLBAR_RADIUS,
-        BND_SCROLLBAR_RADIUS,BND_SCROLLBAR_RADIUS,
-        bndOffsetColor(
-            itemColor, 3*bnd_theme.scrollBarTheme.shadeTop),
-        bndOffsetColor(
-            itemColor, 3*bnd_theme.scrollBarTheme.shadeDown));
-    bndOutlineBox(ctx,x,y,w,h,
+    bndInnerOutlineBox(ctx,x,y,w,h,
         BND_SCROLLBAR_RADIUS,BND_SCROLLBAR_RADIUS,
         BND_SCROLLBAR_RADIUS,BND_SCROLLBAR_RADIUS,
-        bndTransparent(bnd_theme.scrollBarTheme.outlineColor));
+        bndOffsetColor(itemColor, 3*theme->shadeTop),
+        bndOffsetColor(itemColor, 3*theme->shadeDown),
+        bnd_colors(BND_SCROLL_BAR_THEME, BND_DEFAULT, 0)->outline);
+    BND_STATS_EXIT();
 }
 
 void bndMenuBackground(NVGcontext *ctx,
     float x, float y, float w, float h, int flags) {
     float cr[4];
-    NVGcolor shade_top, shade_down;
+    const BNDwidgetColors *colors = bnd_colors(BND_MENU_THEME, BND_DEFAULT, 0);
+    BND_STATS_ENTER();
 
     bndSelectCorners(cr, BND_MENU_RADIUS, flags);
-    bndInnerColors(&shade_top, &shade_down, &bnd_theme.menuTheme,
-        BND_DEFAULT, 0);
-    bndInnerBox(ctx,x,y,w,h+1,cr[0],cr[1],cr[2],cr[3], shade_top, shade_down);
-    bndOutlineBox(ctx,x,y,w,h+1,cr[0],cr[1],cr[2],cr[3],
-        bndTransparent(bnd_theme.menuTheme.outlineColor));
+    bndInnerOutlineBox(ctx,x,y,w,h+1,cr[0],cr[1],cr[2],cr[3],
+        colors->shade_top, colors->shade_down, colors->outline);
     bndDropShadow(ctx,x,y,w,h,BND_MENU_RADIUS,
         BND_SHADOW_FEATHER,BND_SHADOW_ALPHA);
+    BND_STATS_EXIT();
 }
 
 void bndTooltipBackground(NVGcontext *ctx, float x, float y, float w, float h) {
-    NVGcolor shade_top, shade_down;
+    const BNDwidgetColors *colors =
+        bnd_colors(BND_TOOLTIP_THEME, BND_DEFAULT, 0);
+    BND_STATS_ENTER();
 
-    bndInnerColors(&shade_top, &shade_down, &bnd_theme.tooltipTheme,
-        BND_DEFAULT, 0);
-    bndInnerBox(ctx,x,y,w,h+1,
+    bndInnerOutlineBox(ctx,x,y,w,h+1,
         BND_MENU_RADIUS,BND_MENU_RADIUS,BND_MENU_RADIUS,BND_MENU_RADIUS,
-        shade_top, shade_down);
-    bndOutlineBox(ctx,x,y,w,h+1,
-        BND_MENU_RADIUS,BND_MENU_RADIUS,BND_MENU_RADIUS,BND_MENU_RADIUS,
-        bndTransparent(bnd_theme.tooltipTheme.outlineColor));
+        colors->shade_top, colors->shade_down, colors->outline);
     bndDropShadow(ctx,x,y,w,h,BND_MENU_RADIUS,
         BND_SHADOW_FEATHER,BND_SHADOW_ALPHA);
+    BND_STATS_EXIT();
 }
 
 void bndMenuLabel(NVGcontext *ctx,
     float x, float y, float w, float h, int iconid, const char *label) {
+    BND_STATS_ENTER();
     bndIconLabelValue(ctx,x,y,w,h,iconid,
-        bnd_theme.menuTheme.textColor, BND_LEFT,
+        bnd_context->theme.menuTheme.textColor, BND_LEFT,
         BND_LABEL_FONT_SIZE, label, NULL);
+    BND_STATS_EXIT();
 }
 
 void bndMenuItem(NVGcontext *ctx,
     float x, float y, float w, float h, BNDwidgetState state,
     int iconid, const char *label) {
+    const BNDwidgetColors *colors;
+    BND_STATS_ENTER();
     if (state != BND_DEFAULT) {
-        bndInnerBox(ctx,x,y,w,h,0,0,0,0,
-            bndOffsetColor(bnd_theme.menuItemTheme.innerSelectedColor,
-                bnd_theme.menuItemTheme.shadeTop),
-            bndOffsetColor(bnd_theme.menuItemTheme.innerSelectedColor,
-                bnd_theme.menuItemTheme.shadeDown));
         state = BND_ACTIVE;
     }
+    colors = bnd_colors(BND_MENU_ITEM_THEME, state, 0);
+    if (state == BND_ACTIVE) {
+        bndInnerBox(ctx,x,y,w,h,0,0,0,0,
+            colors->shade_top, colors->shade_down);
+    }
     bndIconLabelValue(ctx,x,y,w,h,iconid,
-        bndTextColor(&bnd_theme.menuItemTheme, state), BND_LEFT,
+        colors->text, BND_LEFT,
         BND_LABEL_FONT_SIZE, label, NULL);
+    BND_STATS_EXIT();
 }
 
 void bndNodePort(NVGcontext *ctx, float x, float y, BNDwidgetState state,
     NVGcolor color) {
+    BND_STATS_ENTER();
     nvgBeginPath(ctx);
     nvgCircle(ctx, x, y, BND_NODE_PORT_RADIUS);
-    nvgStrokeColor(ctx,bnd_theme.nodeTheme.wiresColor);
+    nvgStrokeColor(ctx,bnd_context->theme.nodeTheme.wiresColor);
     nvgStrokeWidth(ctx,1.0f);
     nvgStroke(ctx);
     nvgFillColor(ctx,(state != BND_DEFAULT)?
         bndOffsetColor(color, BND_HOVER_SHADE):color);
     nvgFill(ctx);
+    BND_STATS_EXIT();
+}
+
+// returns the number of line segments needed to flatten a wire bezier with
+// the given control point offset delta at the given scale
+static int bnd_wire_segments(float x0, float y0, float x1, float y1,
+    float delta, float scale) {
+    // both second differences of the control points have the same length;
+    // uniform subdivision into n segments stays within M/(8*n*n) of the
+    // curve, where M = 6*|P0-2*P1+P2| bounds the second derivative.
+    float dx = x1 - x0 - 3*delta;
+    float dy = y1 - y0;
+    float m = 6*sqrtf(dx*dx + dy*dy)*scale;
+    int n = (int)ceilf(sqrtf(m/(8*BND_NODE_WIRE_TOLERANCE)));
+    return (n < 1)?1:(n > BND_NODE_WIRE_MAX_SEGMENTS)?
+        BND_NODE_WIRE_MAX_SEGMENTS:n;
+}
+
+// writes the n+1 points of a wire bezier flattened into n segments
+static void bnd_flatten_wire(float *pts, int n,
+    float x0, float y0, float x1, float y1, float delta) {
+    int i;
+    for (i = 0; i <= n; ++i) {
+        float t = (float)i/(float)n;
+        float mt = 1-t;
+        float b0 = mt*mt*mt;
+        float b1 = 3*mt*mt*t;
+        float b2 = 3*mt*t*t;
+        float b3 = t*t*t;
+        *pts++ = b0*x0 + b1*(x0+delta) + b2*(x1-delta) + b3*x1;
+        *pts++ = (b0+b1)*y0 + (b2+b3)*y1;
+    }
+}
+
+// adds the bezier of a wire from p[0],p[1] to p[2],p[3] to the current path
+static void bnd_wire_bezier(NVGcontext *ctx, const float *p, float curving) {
+    float delta = bnd_fmaxf(fabsf(p[2] - p[0]),fabsf(p[3] - p[1]))*curving;
+    nvgMoveTo(ctx, p[0], p[1]);
+    nvgBezierTo(ctx, p[0] + delta, p[1], p[2] - delta, p[3], p[2], p[3]);
+}
+
+static int bnd_same_color(NVGcolor a, NVGcolor b) {
+    return (a.r == b.r) && (a.g == b.g) && (a.b == b.b) && (a.a == b.a);
 }
 
 void bndColoredNodeWire(NVGcontext *ctx, float x0, float y0, float x1, float y1,
     NVGcolor color0, NVGcolor color1) {
+    float curving = (float)bnd_context->theme.nodeTheme.noodleCurving/10.0f;
     float length = bnd_fmaxf(fabsf(x1 - x0),fabsf(y1 - y0));
-    float delta = length*(float)bnd_theme.nodeTheme.noodleCurving/10.0f;
+    float delta = length*curving;
+    BND_STATS_ENTER();
 
     nvgBeginPath(ctx);
     nvgMoveTo(ctx, x0, y0);
@@ -542,7 +1158,7 @@ void bndColoredNodeWire(NVGcontext *ctx, float x0, float y0, float x1, float y1,
         x0 + delta, y0,
         x1 - delta, y1,
         x1, y1);
-    NVGcolor colorw = bnd_theme.nodeTheme.wiresColor;
+    NVGcolor colorw = bnd_context->theme.nodeTheme.wiresColor;
     colorw.a = (color0.a<color1.a)?color0.a:color1.a;
     nvgStrokeColor(ctx, colorw);
     nvgStrokeWidth(ctx, BND_NODE_WIRE_OUTLINE_WIDTH);
@@ -553,29 +1169,111 @@ void bndColoredNodeWire(NVGcontext *ctx, float x0, float y0, float x1, float y1,
         color1));
     nvgStrokeWidth(ctx,BND_NODE_WIRE_WIDTH);
     nvgStroke(ctx);
+    BND_STATS_EXIT();
+}
+
+// a wire of bndColoredNodeWires() and the solid color it is grouped by
+typedef struct BNDwireKey {
+    NVGcolor color;
+    int wire;
+} BNDwireKey;
+
+// orders wire keys by color, then by wire index
+static int bnd_compare_wire_keys(const void *a, const void *b) {
+    const BNDwireKey *ka = (const BNDwireKey *)a;
+    const BNDwireKey *kb = (const BNDwireKey *)b;
+    int i;
+    for (i = 0; i < 4; ++i) {
+        if (ka->color.rgba[i] != kb->color.rgba[i])
+            return (ka->color.rgba[i] < kb->color.rgba[i])?-1:1;
+    }
+    return ka->wire - kb->wire;
+}
+
+void bndColoredNodeWires(NVGcontext *ctx, int count,
+    const float *points, const NVGcolor *colors) {
+    BNDcontext *bnd = bnd_context;
+    float curving = (float)bnd->theme.nodeTheme.noodleCurving/10.0f;
+    NVGcolor colorw = bnd->theme.nodeTheme.wiresColor;
+    BNDwireKey *keys;
+    int i, j, solid = 0;
+    BND_STATS_ENTER();
+
+    if (count <= 0) BND_STATS_RETURN();
+    keys = (BNDwireKey *)bnd_reserve(&bnd->wire_keys,
+        sizeof(BNDwireKey)*count);
+    if (!keys) BND_STATS_RETURN();
+
+    // solid wires first, sorted so that each color is one run of keys;
+    // gradient wires after them in the order they were passed
+    for (i = 0; i < count; ++i) {
+        if (!bnd_same_color(colors[2*i], colors[2*i+1])) continue;
+        keys[solid].color = colors[2*i];
+        keys[solid++].wire = i;
+    }
+    for (i = 0, j = solid; i < count; ++i) {
+        if (bnd_same_color(colors[2*i], colors[2*i+1])) continue;
+        keys[j++].wire = i;
+    }
+    qsort(keys, solid, sizeof(BNDwireKey), bnd_compare_wire_keys);
+
+    // one path per solid color, stroked as outline and then as core
+    for (i = 0; i < solid; i = j) {
+        NVGcolor color = keys[i].color;
+        nvgBeginPath(ctx);
+        for (j = i; (j < solid) && bnd_same_color(keys[j].color, color); ++j)
+            bnd_wire_bezier(ctx, points + 4*keys[j].wire, curving);
+        colorw.a = color.a;
+        nvgStrokeColor(ctx, colorw);
+        nvgStrokeWidth(ctx, BND_NODE_WIRE_OUTLINE_WIDTH);
+        nvgStroke(ctx);
+        nvgStrokeColor(ctx, color);
+        nvgStrokeWidth(ctx, BND_NODE_WIRE_WIDTH);
+        nvgStroke(ctx);
+    }
+
+    // gradient wires one by one, as bndColoredNodeWire() draws them
+    for (i = solid; i < count; ++i) {
+        const float *p = points + 4*keys[i].wire;
+        const NVGcolor *c = colors + 2*keys[i].wire;
+        nvgBeginPath(ctx);
+        bnd_wire_bezier(ctx, p, curving);
+        colorw.a = bnd_fminf(c[0].a, c[1].a);
+        nvgStrokeColor(ctx, colorw);
+        nvgStrokeWidth(ctx, BND_NODE_WIRE_OUTLINE_WIDTH);
+        nvgStroke(ctx);
+        nvgStrokePaint(ctx, nvgLinearGradient(ctx,
+            p[0], p[1], p[2], p[3], c[0], c[1]));
+        nvgStrokeWidth(ctx, BND_NODE_WIRE_WIDTH);
+        nvgStroke(ctx);
+    }
+    BND_STATS_EXIT();
 }
 
 void bndNodeWire(NVGcontext *ctx, float x0, float y0, float x1, float y1,
     BNDwidgetState state0, BNDwidgetState state1) {
+    BND_STATS_ENTER();
     bndColoredNodeWire(ctx, x0, y0, x1, y1,
-        bndNodeWireColor(&bnd_theme.nodeTheme, state0),
-        bndNodeWireColor(&bnd_theme.nodeTheme, state1));
+        bndNodeWireColor(&bnd_context->theme.nodeTheme, state0),
+        bndNodeWireColor(&bnd_context->theme.nodeTheme, state1));
+    BND_STATS_EXIT();
 }
 
 void bndNodeBackground(NVGcontext *ctx, float x, float y, float w, float h,
     BNDwidgetState state, int iconid, const char *label, NVGcolor titleColor) {
+    BND_STATS_ENTER();
     bndInnerBox(ctx,x,y,w,BND_NODE_TITLE_HEIGHT+2,
         BND_NODE_RADIUS,BND_NODE_RADIUS,0,0,
         bndTransparent(bndOffsetColor(titleColor, BND_BEVEL_SHADE)),
         bndTransparent(titleColor));
     bndInnerBox(ctx,x,y+BND_NODE_TITLE_HEIGHT-1,w,h+2-BND_NODE_TITLE_HEIGHT,
         0,0,BND_NODE_RADIUS,BND_NODE_RADIUS,
-        bndTransparent(bnd_theme.nodeTheme.nodeBackdropColor),
-        bndTransparent(bnd_theme.nodeTheme.nodeBackdropColor));
+        bndTransparent(bnd_context->theme.nodeTheme.nodeBackdropColor),
+        bndTransparent(bnd_context->theme.nodeTheme.nodeBackdropColor));
     bndNodeIconLabel(ctx,
         x+BND_NODE_ARROW_AREA_WIDTH,y,
         w-BND_NODE_ARROW_AREA_WIDTH-BND_NODE_MARGIN_SIDE,BND_NODE_TITLE_HEIGHT,
-        iconid, bnd_theme.regularTheme.textColor,
+        iconid, bnd_context->theme.regularTheme.textColor,
         bndOffsetColor(titleColor, BND_BEVEL_SHADE),
         BND_LEFT, BND_LABEL_FONT_SIZE, label);
     NVGcolor arrowColor;
@@ -587,12 +1285,12 @@ void bndNodeBackground(NVGcontext *ctx, float x, float y, float w, float h,
         arrowColor = bndOffsetColor(titleColor, -BND_BEVEL_SHADE);
     } break;
     case BND_HOVER: {
-        borderColor = bnd_theme.nodeTheme.nodeSelectedColor;
-        arrowColor = bnd_theme.nodeTheme.nodeSelectedColor;
+        borderColor = bnd_context->theme.nodeTheme.nodeSelectedColor;
+        arrowColor = bnd_context->theme.nodeTheme.nodeSelectedColor;
     } break;
     case BND_ACTIVE: {
-        borderColor = bnd_theme.nodeTheme.activeNodeColor;
-        arrowColor = bnd_theme.nodeTheme.nodeSelectedColor;
+        borderColor = bnd_context->theme.nodeTheme.activeNodeColor;
+        arrowColor = bnd_context->theme.nodeTheme.nodeSelectedColor;
     } break;
     }
     bndOutlineBox(ctx,x,y,w,h+1,
@@ -605,17 +1303,19 @@ void bndNodeBackground(NVGcontext *ctx, float x, float y, float w, float h,
     */
     bndDropShadow(ctx,x,y,w,h,BND_NODE_RADIUS,
         BND_SHADOW_FEATHER,BND_SHADOW_ALPHA);
+    BND_STATS_EXIT();
 }
 
 void bndSplitterWidgets(NVGcontext *ctx, float x, float y, float w, float h) {
     NVGcolor insetLight = bndTransparent(
-        bndOffsetColor(bnd_theme.backgroundColor, BND_SPLITTER_SHADE));
+        bndOffsetColor(bnd_context->theme.backgroundColor, BND_SPLITTER_SHADE));
     NVGcolor insetDark = bndTransparent(
-        bndOffsetColor(bnd_theme.backgroundColor, -BND_SPLITTER_SHADE));
-    NVGcolor inset = bndTransparent(bnd_theme.backgroundColor);
+        bndOffsetColor(bnd_context->theme.backgroundColor, -BND_SPLITTER_SHADE));
+    NVGcolor inset = bndTransparent(bnd_context->theme.backgroundColor);
 
     float x2 = x+w;
     float y2 = y+h;
+    BND_STATS_ENTER();
 
     nvgBeginPath(ctx);
     nvgMoveTo(ctx, x, y2-13);
@@ -670,10 +1370,12 @@ void bndSplitterWidgets(NVGcontext *ctx, float x, float y, float w, float h) {
 
     nvgStrokeColor(ctx, inset);
     nvgStroke(ctx);
+    BND_STATS_EXIT();
 }
 
 void bndJoinAreaOverlay(NVGcontext *ctx, float x, float y, float w, float h,
     int vertical, int mirror) {
+    BND_STATS_ENTER();
 
     if (vertical) {
         float u = w;
@@ -725,41 +1427,42 @@ void bndJoinAreaOverlay(NVGcontext *ctx, float x, float y, float w, float h,
 
     nvgFillColor(ctx, nvgRGBAf(0,0,0,0.3));
     nvgFill(ctx);
+    BND_STATS_EXIT();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 float bndLabelWidth(NVGcontext *ctx, int iconid, const char *label) {
     int w = BND_PAD_LEFT + BND_PAD_RIGHT;
+    BND_STATS_ENTER();
     if (iconid >= 0) {
         w += BND_ICON_SHEET_RES;
     }
-    if (label && (bnd_font >= 0)) {
-        nvgFontFaceId(ctx, bnd_font);
-        nvgFontSize(ctx, BND_LABEL_FONT_SIZE);
+    if (label && (bnd_context->font >= 0)) {
+        nvgFontFaceId(ctx, bnd_context->font);
         float bounds[4];
-        nvgTextBoxBounds(ctx, 1, 1, INFINITY, label, NULL, bounds);
+        bnd_text_bounds(ctx, BND_LABEL_FONT_SIZE, INFINITY, label, bounds);
         w += bounds[2];
     }
-    return w;
+    BND_STATS_RETURN(w);
 }
 
 float bndLabelHeight(NVGcontext *ctx, int iconid, const char *label, float width) {
 	int h = BND_WIDGET_HEIGHT;
+    BND_STATS_ENTER();
     width -= BND_TEXT_RADIUS*2;
     if (iconid >= 0) {
         width -= BND_ICON_SHEET_RES;
     }
-    if (label && (bnd_font >= 0)) {
-        nvgFontFaceId(ctx, bnd_font);
-        nvgFontSize(ctx, BND_LABEL_FONT_SIZE);
+    if (label && (bnd_context->font >= 0)) {
+        nvgFontFaceId(ctx, bnd_context->font);
         float bounds[4];
-        nvgTextBoxBounds(ctx, 1, 1, width, label, NULL, bounds);
+        bnd_text_bounds(ctx, BND_LABEL_FONT_SIZE, width, label, bounds);
         int bh = (int)(bounds[3] - bounds[1]) + BND_TEXT_PAD_DOWN;
         if (bh > h)
         	h = bh;
     }
-    return h;
+    BND_STATS_RETURN(h);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -767,9 +1470,14 @@ float bndLabelHeight(NVGcontext *ctx, int iconid, const char *label, float width
 void bndRoundedBox(NVGcontext *ctx, float x, float y, float w, float h,
     float cr0, float cr1, float cr2, float cr3) {
     float d;
+    BND_STATS_ENTER();
 
     w = bnd_fmaxf(0, w);
     h = bnd_fmaxf(0, h);
+    if (bnd_lod(ctx) >= BND_LOD_NO_CORNERS) {
+        nvgRect(ctx, x, y, w, h);
+        BND_STATS_RETURN();
+    }
     d = bnd_fminf(w, h);
 
     nvgMoveTo(ctx, x,y+h*0.5f);
@@ -778,6 +1486,7 @@ void bndRoundedBox(NVGcontext *ctx, float x, float y, float w, float h,
     nvgArcTo(ctx, x+w,y+h, x,y+h, bnd_fminf(cr2, d/2));
     nvgArcTo(ctx, x,y+h, x,y, bnd_fminf(cr3, d/2));
     nvgClosePath(ctx);
+    BND_STATS_EXIT();
 }
 
 NVGcolor bndTransparent(NVGcolor color) {
@@ -811,7 +1520,7 @@ void bndBevel(NVGcontext *ctx, float x, float y, float w, float h) {
     nvgLineTo(ctx, x+w, y+h);
     nvgLineTo(ctx, x+w, y);
     nvgStrokeColor(ctx, bndTransparent(
-        bndOffsetColor(bnd_theme.backgroundColor, -BND_BEVEL_SHADE)));
+        bndOffsetColor(bnd_context->theme.backgroundColor, -BND_BEVEL_SHADE)));
     nvgStroke(ctx);
 
     nvgBeginPath(ctx);
@@ -819,7 +1528,7 @@ void bndBevel(NVGcontext *ctx, float x, float y, float w, float h) {
     nvgLineTo(ctx, x, y);
     nvgLineTo(ctx, x+w, y);
     nvgStrokeColor(ctx, bndTransparent(
-        bndOffsetColor(bnd_theme.backgroundColor, BND_BEVEL_SHADE)));
+        bndOffsetColor(bnd_context->theme.backgroundColor, BND_BEVEL_SHADE)));
     nvgStroke(ctx);
 }
 
@@ -839,7 +1548,7 @@ void bndBevelInset(NVGcontext *ctx, float x, float y, float w, float h,
     nvgArcTo(ctx, x+w,y+h, x,y+h, cr2);
     nvgArcTo(ctx, x,y+h, x,y, cr3);
 
-    NVGcolor bevelColor = bndOffsetColor(bnd_theme.backgroundColor,
+    NVGcolor bevelColor = bndOffsetColor(bnd_context->theme.backgroundColor,
         BND_INSET_BEVEL_SHADE);
 
     nvgStrokeWidth(ctx, 1);
@@ -853,15 +1562,19 @@ void bndBevelInset(NVGcontext *ctx, float x, float y, float w, float h,
 }
 
 void bndBackground(NVGcontext *ctx, float x, float y, float w, float h) {
+    BND_STATS_ENTER();
     nvgBeginPath(ctx);
     nvgRect(ctx, x, y, w, h);
-    nvgFillColor(ctx, bnd_theme.backgroundColor);
+    nvgFillColor(ctx, bnd_context->theme.backgroundColor);
     nvgFill(ctx);
+    BND_STATS_EXIT();
 }
 
 void bndIcon(NVGcontext *ctx, float x, float y, int iconid) {
     int ix, iy, u, v;
-    if (bnd_icon_image < 0) return; // no icons loaded
+    BND_STATS_ENTER();
+    if (bnd_context->icon_image < 0) BND_STATS_RETURN(); // no icons loaded
+    if (bnd_lod(ctx) >= BND_LOD_NO_TEXT) BND_STATS_RETURN();
 
     ix = iconid & 0xff;
     iy = (iconid>>8) & 0xff;
@@ -874,12 +1587,15 @@ void bndIcon(NVGcontext *ctx, float x, float y, int iconid) {
         nvgImagePattern(ctx,x-u,y-v,
         BND_ICON_SHEET_WIDTH,
         BND_ICON_SHEET_HEIGHT,
-        0,bnd_icon_image,1));
+        0,bnd_context->icon_image,1));
     nvgFill(ctx);
+    BND_STATS_EXIT();
 }
 
 void bndDropShadow(NVGcontext *ctx, float x, float y, float w, float h,
     float r, float feather, float alpha) {
+    BND_STATS_ENTER();
+    if (bnd_lod(ctx) >= BND_LOD_NO_GRADIENTS) BND_STATS_RETURN();
 
     nvgBeginPath(ctx);
     y += feather;
@@ -904,27 +1620,44 @@ void bndDropShadow(NVGcontext *ctx, float x, float y, float w, float h,
         nvgRGBAf(0,0,0,alpha*alpha),
         nvgRGBAf(0,0,0,0)));
     nvgFill(ctx);
+    BND_STATS_EXIT();
 }
 
 void bndInnerBox(NVGcontext *ctx, float x, float y, float w, float h,
     float cr0, float cr1, float cr2, float cr3,
     NVGcolor shade_top, NVGcolor shade_down) {
+    BND_STATS_ENTER();
     nvgBeginPath(ctx);
     bndRoundedBox(ctx,x+1,y+1,w-2,h-3,bnd_fmaxf(0,cr0-1),
         bnd_fmaxf(0,cr1-1),bnd_fmaxf(0,cr2-1),bnd_fmaxf(0,cr3-1));
-    nvgFillPaint(ctx,((h-2)>w)?
-        nvgLinearGradient(ctx,x,y,x+w,y,shade_top,shade_down):
-        nvgLinearGradient(ctx,x,y,x,y+h,shade_top,shade_down));
+    bnd_inner_fill(ctx,bnd_lod(ctx),x,y,w,h,shade_top,shade_down);
     nvgFill(ctx);
+    BND_STATS_EXIT();
 }
 
 void bndOutlineBox(NVGcontext *ctx, float x, float y, float w, float h,
     float cr0, float cr1, float cr2, float cr3, NVGcolor color) {
+    BND_STATS_ENTER();
+    if (bnd_lod(ctx) >= BND_LOD_NO_CORNERS) BND_STATS_RETURN();
     nvgBeginPath(ctx);
     bndRoundedBox(ctx,x+0.5f,y+0.5f,w-1,h-2,cr0,cr1,cr2,cr3);
     nvgStrokeColor(ctx,color);
     nvgStrokeWidth(ctx,1);
     nvgStroke(ctx);
+    BND_STATS_EXIT();
+}
+
+void bndInnerOutlineBox(NVGcontext *ctx, float x, float y, float w, float h,
+    float cr0, float cr1, float cr2, float cr3,
+    NVGcolor shade_top, NVGcolor shade_down, NVGcolor outline) {
+    int lod, shared;
+    BND_STATS_ENTER();
+    lod = bnd_lod(ctx);
+    shared = bnd_inner_box_path(ctx,lod,x,y,w,h,cr0,cr1,cr2,cr3);
+    bnd_inner_fill(ctx,lod,x,y,w,h,shade_top,shade_down);
+    nvgFill(ctx);
+    bnd_outline_box_stroke(ctx,lod,shared,x,y,w,h,cr0,cr1,cr2,cr3,outline);
+    BND_STATS_EXIT();
 }
 
 void bndSelectCorners(float *radiuses, float r, int flags) {
@@ -966,27 +1699,30 @@ void bndIconLabelValue(NVGcontext *ctx, float x, float y, float w, float h,
     int iconid, NVGcolor color, int align, float fontsize, const char *label,
     const char *value) {
     float pleft = BND_PAD_LEFT;
+    BND_STATS_ENTER();
+    if (bnd_lod(ctx) >= BND_LOD_NO_TEXT) BND_STATS_RETURN();
     if (label) {
         if (iconid >= 0) {
             bndIcon(ctx,x+4,y+2,iconid);
             pleft += BND_ICON_SHEET_RES;
         }
 
-        if (bnd_font < 0) return;
-        nvgFontFaceId(ctx, bnd_font);
+        if (bnd_context->font < 0) BND_STATS_RETURN();
+        nvgFontFaceId(ctx, bnd_context->font);
         nvgFontSize(ctx, fontsize);
         nvgBeginPath(ctx);
         nvgFillColor(ctx, color);
         if (value) {
-            float label_width = nvgTextBounds(ctx, 1, 1, label, NULL, NULL);
-            float sep_width = nvgTextBounds(ctx, 1, 1,
-                BND_LABEL_SEPARATOR, NULL, NULL);
+            float label_width = bnd_text_bounds(ctx, fontsize, -1,
+                label, NULL);
+            float sep_width = bnd_text_bounds(ctx, fontsize, -1,
+                BND_LABEL_SEPARATOR, NULL);
 
             nvgTextAlign(ctx, NVG_ALIGN_LEFT|NVG_ALIGN_BASELINE);
             x += pleft;
             if (align == BND_CENTER) {
                 float width = label_width + sep_width
-                    + nvgTextBounds(ctx, 1, 1, value, NULL, NULL);
+                    + bnd_text_bounds(ctx, fontsize, -1, value, NULL);
                 x += ((w-BND_PAD_RIGHT-pleft)-width)*0.5f;
             }
             y += BND_WIDGET_HEIGHT-BND_TEXT_PAD_DOWN;
@@ -1005,13 +1741,16 @@ void bndIconLabelValue(NVGcontext *ctx, float x, float y, float w, float h,
     } else if (iconid >= 0) {
         bndIcon(ctx,x+2,y+2,iconid);
     }
+    BND_STATS_EXIT();
 }
 
 void bndNodeIconLabel(NVGcontext *ctx, float x, float y, float w, float h,
     int iconid, NVGcolor color, NVGcolor shadowColor,
     int align, float fontsize, const char *label) {
-    if (label && (bnd_font >= 0)) {
-        nvgFontFaceId(ctx, bnd_font);
+    BND_STATS_ENTER();
+    if (bnd_lod(ctx) >= BND_LOD_NO_TEXT) BND_STATS_RETURN();
+    if (label && (bnd_context->font >= 0)) {
+        nvgFontFaceId(ctx, bnd_context->font);
         nvgFontSize(ctx, fontsize);
         nvgBeginPath(ctx);
         nvgTextAlign(ctx, NVG_ALIGN_LEFT|NVG_ALIGN_BASELINE);
@@ -1027,39 +1766,41 @@ void bndNodeIconLabel(NVGcontext *ctx, float x, float y, float w, float h,
     if (iconid >= 0) {
         bndIcon(ctx,x+w-BND_ICON_SHEET_RES,y+3,iconid);
     }
+    BND_STATS_EXIT();
 }
 
 int bndIconLabelTextPosition(NVGcontext *ctx, float x, float y, float w, float h,
     int iconid, float fontsize, const char *label, int px, int py) {
     float bounds[4];
     float pleft = BND_TEXT_RADIUS;
-    if (!label) return -1;
+    BND_STATS_ENTER();
+    if (!label) BND_STATS_RETURN(-1);
     if (iconid >= 0)
         pleft += BND_ICON_SHEET_RES;
 
-    if (bnd_font < 0) return -1;
+    if (bnd_context->font < 0) BND_STATS_RETURN(-1);
 
     x += pleft;
     y += BND_WIDGET_HEIGHT - BND_TEXT_PAD_DOWN;
 
-    nvgFontFaceId(ctx, bnd_font);
+    nvgFontFaceId(ctx, bnd_context->font);
     nvgFontSize(ctx, fontsize);
     nvgTextAlign(ctx, NVG_ALIGN_LEFT | NVG_ALIGN_BASELINE);
 
     w -= BND_TEXT_RADIUS + pleft;
 
     float asc, desc, lh;
-    static NVGtextRow rows[BND_MAX_ROWS];
+    NVGtextRow *rows = bnd_context->rows;
     int nrows = nvgTextBreakLines(
         ctx, label, NULL, w, rows, BND_MAX_ROWS);
-    if (nrows == 0) return 0;
+    if (nrows == 0) BND_STATS_RETURN(0);
     nvgTextBoxBounds(ctx, x, y, w, label, NULL, bounds);
     nvgTextMetrics(ctx, &asc, &desc, &lh);
 
     // calculate vertical position
     int row = bnd_clamp((int)((float)(py - bounds[1]) / lh), 0, nrows - 1);
     // search horizontal position
-    static NVGglyphPosition glyphs[BND_MAX_GLYPHS];
+    NVGglyphPosition *glyphs = bnd_context->glyphs;
     int nglyphs = nvgTextGlyphPositions(
         ctx, x, y, rows[row].start, rows[row].end + 1, glyphs, BND_MAX_GLYPHS);
     int col, p = 0;
@@ -1068,13 +1809,13 @@ int bndIconLabelTextPosition(NVGcontext *ctx, float x, float y, float w, float h
     // see if we should move one character further
     if (col > 0 && col < nglyphs && glyphs[col].x - px < px - glyphs[col - 1].x)
         p = glyphs[col].str - label;
-    return p;
+    BND_STATS_RETURN(p);
 }
 
 static void bndCaretPosition(NVGcontext *ctx, float x, float y,
     float desc, float lineHeight, const char *caret, NVGtextRow *rows,int nrows,
     int *cr, float *cx, float *cy) {
-    static NVGglyphPosition glyphs[BND_MAX_GLYPHS];
+    NVGglyphPosition *glyphs = bnd_context->glyphs;
     int r,nglyphs;
     for (r=0; r < nrows-1 && rows[r].end < caret; ++r);
     *cr = r;
@@ -1094,18 +1835,20 @@ void bndIconLabelCaret(NVGcontext *ctx, float x, float y, float w, float h,
     int iconid, NVGcolor color, float fontsize, const char *label,
     NVGcolor caretcolor, int cbegin, int cend) {
     float pleft = BND_TEXT_RADIUS;
-    if (!label) return;
+    BND_STATS_ENTER();
+    if (!label) BND_STATS_RETURN();
+    if (bnd_lod(ctx) >= BND_LOD_NO_TEXT) BND_STATS_RETURN();
     if (iconid >= 0) {
         bndIcon(ctx,x+4,y+2,iconid);
         pleft += BND_ICON_SHEET_RES;
     }
 
-    if (bnd_font < 0) return;
+    if (bnd_context->font < 0) BND_STATS_RETURN();
 
     x+=pleft;
     y+=BND_WIDGET_HEIGHT-BND_TEXT_PAD_DOWN;
 
-    nvgFontFaceId(ctx, bnd_font);
+    nvgFontFaceId(ctx, bnd_context->font);
     nvgFontSize(ctx, fontsize);
     nvgTextAlign(ctx, NVG_ALIGN_LEFT|NVG_ALIGN_BASELINE);
 
@@ -1115,7 +1858,7 @@ void bndIconLabelCaret(NVGcontext *ctx, float x, float y, float w, float h,
         int c0r,c1r;
         float c0x,c0y,c1x,c1y;
         float desc,lh;
-        static NVGtextRow rows[BND_MAX_ROWS];
+        NVGtextRow *rows = bnd_context->rows;
         int nrows = nvgTextBreakLines(
             ctx, label, label+cend+1, w, rows, BND_MAX_ROWS);
         nvgTextMetrics(ctx, NULL, &desc, &lh);
@@ -1148,9 +1891,336 @@ void bndIconLabelCaret(NVGcontext *ctx, float x, float y, float w, float h,
     nvgBeginPath(ctx);
     nvgFillColor(ctx, color);
     nvgTextBox(ctx,x,y,w,label, NULL);
+    BND_STATS_EXIT();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct BNDlabel {
+    // owned copy of the text
+    char *text;
+    int length;
+    float fontsize;
+    // nanovg context, font and break width the label was shaped with;
+    // breakwidth is < 0 if the label has not been shaped yet
+    NVGcontext *ctx;
+    int font;
+    float breakwidth;
+    // single line advance of the whole text
+    float advance;
+    // bounds of the text box relative to a baseline origin at (0,0)
+    float bounds[4];
+    float asc, desc, lineh;
+    int nrows;
+    int maxrows;
+    NVGtextRow *rows;
+    // glyphs of row r are glyphs[rowglyphs[r]..rowglyphs[r+1]-1], their x
+    // positions are relative to (0,0); every row includes the glyph
+    // following its end, as bndCaretPosition() expects.
+    int *rowglyphs;
+    int nglyphs;
+    int maxglyphs;
+    NVGglyphPosition *glyphs;
+};
+
+static int bnd_shape_label(NVGcontext *ctx, BNDlabel *label, float width) {
+    NVGtextRow rows[BND_MAX_ROWS];
+    const char *start = label->text;
+    const char *end = label->text + label->length;
+    int n, r;
+
+    nvgFontFaceId(ctx, bnd_context->font);
+    nvgFontSize(ctx, label->fontsize);
+    nvgTextAlign(ctx, NVG_ALIGN_LEFT|NVG_ALIGN_BASELINE);
+
+    label->nrows = 0;
+    while ((n = nvgTextBreakLines(ctx, start, end, width, rows, BND_MAX_ROWS))) {
+        if (label->nrows + n > label->maxrows) {
+            int maxrows = (label->nrows + n)*2;
+            NVGtextRow *newrows = (NVGtextRow *)realloc(label->rows,
+                sizeof(NVGtextRow)*maxrows);
+            int *newrowglyphs = (int *)realloc(label->rowglyphs,
+                sizeof(int)*(maxrows+1));
+            if (newrows) label->rows = newrows;
+            if (newrowglyphs) label->rowglyphs = newrowglyphs;
+            if (!newrows || !newrowglyphs) return 0;
+            label->maxrows = maxrows;
+        }
+        memcpy(label->rows + label->nrows, rows, sizeof(NVGtextRow)*n);
+        label->nrows += n;
+        start = rows[n-1].next;
+        if (start >= end) break;
+    }
+
+    // each row can have at most one glyph per byte plus the trailing glyph
+    if (label->length + label->nrows > label->maxglyphs) {
+        int maxglyphs = label->length + label->nrows;
+        NVGglyphPosition *glyphs = (NVGglyphPosition *)realloc(label->glyphs,
+            sizeof(NVGglyphPosition)*maxglyphs);
+        if (!glyphs) return 0;
+        label->glyphs = glyphs;
+        label->maxglyphs = maxglyphs;
+    }
+    label->nglyphs = 0;
+    for (r = 0; r < label->nrows; ++r) {
+        label->rowglyphs[r] = label->nglyphs;
+        label->nglyphs += nvgTextGlyphPositions(ctx, 0, 0,
+            label->rows[r].start, label->rows[r].end + 1,
+            label->glyphs + label->nglyphs,
+            label->maxglyphs - label->nglyphs);
+    }
+    label->rowglyphs[label->nrows] = label->nglyphs;
+
+    label->advance = nvgTextBounds(ctx, 0, 0, label->text, end, NULL);
+    nvgTextBoxBounds(ctx, 0, 0, width, label->text, end, label->bounds);
+    nvgTextMetrics(ctx, &label->asc, &label->desc, &label->lineh);
+
+    label->ctx = ctx;
+    label->font = bnd_context->font;
+    label->breakwidth = width;
+    return 1;
+}
+
+// re-shapes the label if it was prepared for a different width or font
+static int bnd_prepare_label(NVGcontext *ctx, BNDlabel *label, float width) {
+    if ((label->breakwidth == width) && (label->ctx == ctx)
+        && (label->font == bnd_context->font)) {
+        nvgFontFaceId(ctx, bnd_context->font);
+        nvgFontSize(ctx, label->fontsize);
+        return 1;
+    }
+    return bnd_shape_label(ctx, label, width);
+}
+
+BNDlabel *bndCreateLabel(NVGcontext *ctx, const char *text,
+    float fontsize, float width) {
+    BNDlabel *label;
+    int length = text?(int)strlen(text):0;
+    BND_STATS_ENTER();
+    label = (BNDlabel *)calloc(1, sizeof(BNDlabel));
+    if (!label) BND_STATS_RETURN(NULL);
+    // reserve one byte past the terminator for the trailing glyph
+    label->text = (char *)calloc(length + 2, 1);
+    label->rowglyphs = (int *)calloc(1, sizeof(int));
+    if (!label->text || !label->rowglyphs) {
+        bndDestroyLabel(label);
+        BND_STATS_RETURN(NULL);
+    }
+    if (text)
+        memcpy(label->text, text, length);
+    label->length = length;
+    label->fontsize = fontsize;
+    label->breakwidth = -1;
+    if (ctx && (width >= 0) && (bnd_context->font >= 0))
+        bnd_shape_label(ctx, label, width);
+    BND_STATS_RETURN(label);
+}
+
+void bndDestroyLabel(BNDlabel *label) {
+    if (!label) return;
+    free(label->text);
+    free(label->rows);
+    free(label->rowglyphs);
+    free(label->glyphs);
+    free(label);
+}
+
+const char *bndGetLabelText(const BNDlabel *label) {
+    return label->text;
+}
+
+// draws the rows of a prepared label like nvgTextBox() would
+static void bnd_label_rows(NVGcontext *ctx, const BNDlabel *label,
+    float x, float y, int align) {
+    int r;
+    nvgTextAlign(ctx, NVG_ALIGN_LEFT|NVG_ALIGN_BASELINE);
+    for (r = 0; r < label->nrows; ++r) {
+        const NVGtextRow *row = &label->rows[r];
+        float rx = x;
+        if (align == BND_CENTER)
+            rx += (label->breakwidth - row->width)*0.5f;
+        nvgText(ctx, rx, y, row->start, row->end);
+        y += label->lineh;
+    }
+}
+
+void bndPreparedIconLabelValue(NVGcontext *ctx,
+    float x, float y, float w, int iconid, NVGcolor color, int align,
+    BNDlabel *label, BNDlabel *value) {
+    float pleft = BND_PAD_LEFT;
+    BND_STATS_ENTER();
+    if (bnd_lod(ctx) >= BND_LOD_NO_TEXT) BND_STATS_RETURN();
+    if (label) {
+        if (iconid >= 0) {
+            bndIcon(ctx,x+4,y+2,iconid);
+            pleft += BND_ICON_SHEET_RES;
+        }
+
+        if (bnd_context->font < 0) BND_STATS_RETURN();
+        if (value) {
+            if (!bnd_prepare_label(ctx, value, INFINITY)) BND_STATS_RETURN();
+            if (!bnd_prepare_label(ctx, label, INFINITY)) BND_STATS_RETURN();
+            float label_width = label->advance;
+            float sep_width = bnd_text_bounds(ctx, label->fontsize, -1,
+                BND_LABEL_SEPARATOR, NULL);
+
+            nvgBeginPath(ctx);
+            nvgFillColor(ctx, color);
+            nvgTextAlign(ctx, NVG_ALIGN_LEFT|NVG_ALIGN_BASELINE);
+            x += pleft;
+            if (align == BND_CENTER) {
+                float width = label_width + sep_width + value->advance;
+                x += ((w-BND_PAD_RIGHT-pleft)-width)*0.5f;
+            }
+            y += BND_WIDGET_HEIGHT-BND_TEXT_PAD_DOWN;
+            nvgText(ctx, x, y, label->text, NULL);
+            x += label_width;
+            nvgText(ctx, x, y, BND_LABEL_SEPARATOR, NULL);
+            x += sep_width;
+            nvgFontSize(ctx, value->fontsize);
+            nvgText(ctx, x, y, value->text, NULL);
+        } else {
+            if (!bnd_prepare_label(ctx, label, w-BND_PAD_RIGHT-pleft))
+                BND_STATS_RETURN();
+            nvgBeginPath(ctx);
+            nvgFillColor(ctx, color);
+            bnd_label_rows(ctx, label, x+pleft,
+                y+BND_WIDGET_HEIGHT-BND_TEXT_PAD_DOWN, align);
+        }
+    } else if (iconid >= 0) {
+        bndIcon(ctx,x+2,y+2,iconid);
+    }
+    BND_STATS_EXIT();
+}
+
+void bndPreparedNodeIconLabel(NVGcontext *ctx,
+    float x, float y, float w, float h, int iconid, NVGcolor color,
+    NVGcolor shadowColor, BNDlabel *label) {
+    BND_STATS_ENTER();
+    if (bnd_lod(ctx) >= BND_LOD_NO_TEXT) BND_STATS_RETURN();
+    if (label && (bnd_context->font >= 0) && bnd_prepare_label(ctx, label, w)) {
+        nvgBeginPath(ctx);
+        nvgFillColor(ctx, shadowColor);
+        nvgFontBlur(ctx, BND_NODE_TITLE_FEATHER);
+        bnd_label_rows(ctx, label, x+1, y+h+3-BND_TEXT_PAD_DOWN, BND_LEFT);
+        nvgFillColor(ctx, color);
+        nvgFontBlur(ctx, 0);
+        bnd_label_rows(ctx, label, x, y+h+2-BND_TEXT_PAD_DOWN, BND_LEFT);
+    }
+    if (iconid >= 0) {
+        bndIcon(ctx,x+w-BND_ICON_SHEET_RES,y+3,iconid);
+    }
+    BND_STATS_EXIT();
+}
+
+int bndPreparedIconLabelTextPosition(NVGcontext *ctx,
+    float x, float y, float w, int iconid, BNDlabel *label,
+    int px, int py) {
+    float pleft = BND_TEXT_RADIUS;
+    BND_STATS_ENTER();
+    if (!label) BND_STATS_RETURN(-1);
+    if (iconid >= 0)
+        pleft += BND_ICON_SHEET_RES;
+
+    if (bnd_context->font < 0) BND_STATS_RETURN(-1);
+
+    x += pleft;
+    y += BND_WIDGET_HEIGHT - BND_TEXT_PAD_DOWN;
+    w -= BND_TEXT_RADIUS + pleft;
+
+    if (!bnd_prepare_label(ctx, label, w)) BND_STATS_RETURN(-1);
+    if (label->nrows == 0) BND_STATS_RETURN(0);
+
+    // calculate vertical position
+    int row = bnd_clamp((int)((float)(py - (y + label->bounds[1]))
+        / label->lineh), 0, label->nrows - 1);
+    // search horizontal position
+    const NVGglyphPosition *glyphs = label->glyphs + label->rowglyphs[row];
+    int nglyphs = label->rowglyphs[row+1] - label->rowglyphs[row];
+    float gx = px - x;
+    int col, p = 0;
+    for (col = 0; col < nglyphs && glyphs[col].x < gx; ++col)
+        p = glyphs[col].str - label->text;
+    // see if we should move one character further
+    if (col > 0 && col < nglyphs && glyphs[col].x - gx < gx - glyphs[col - 1].x)
+        p = glyphs[col].str - label->text;
+    BND_STATS_RETURN(p);
+}
+
+static void bndPreparedCaretPosition(const BNDlabel *label, float x, float y,
+    const char *caret, int *cr, float *cx, float *cy) {
+    int r, i;
+    int nrows = label->nrows;
+    for (r=0; r < nrows-1 && label->rows[r].end < caret; ++r);
+    *cr = r;
+    *cx = x;
+    *cy = y-label->lineh-label->desc + r*label->lineh;
+    if (nrows == 0) return;
+    *cx = x+label->rows[r].minx;
+    for (i=label->rowglyphs[r]; i < label->rowglyphs[r+1]; ++i) {
+        *cx=x+label->glyphs[i].x;
+        if (label->glyphs[i].str == caret) break;
+    }
+}
+
+void bndPreparedIconLabelCaret(NVGcontext *ctx,
+    float x, float y, float w, int iconid, NVGcolor color,
+    BNDlabel *label, NVGcolor caretcolor, int cbegin, int cend) {
+    float pleft = BND_TEXT_RADIUS;
+    BND_STATS_ENTER();
+    if (!label) BND_STATS_RETURN();
+    if (bnd_lod(ctx) >= BND_LOD_NO_TEXT) BND_STATS_RETURN();
+    if (iconid >= 0) {
+        bndIcon(ctx,x+4,y+2,iconid);
+        pleft += BND_ICON_SHEET_RES;
+    }
+
+    if (bnd_context->font < 0) BND_STATS_RETURN();
+
+    x+=pleft;
+    y+=BND_WIDGET_HEIGHT-BND_TEXT_PAD_DOWN;
+    w -= BND_TEXT_RADIUS+pleft;
+
+    if (!bnd_prepare_label(ctx, label, w)) BND_STATS_RETURN();
+
+    if (cend >= cbegin) {
+        int c0r,c1r;
+        float c0x,c0y,c1x,c1y;
+        float lh = label->lineh;
+
+        bndPreparedCaretPosition(label, x, y, label->text+cbegin,
+            &c0r, &c0x, &c0y);
+        bndPreparedCaretPosition(label, x, y, label->text+cend,
+            &c1r, &c1x, &c1y);
+
+        nvgBeginPath(ctx);
+        if (cbegin == cend) {
+            nvgFillColor(ctx, nvgRGBf(0.337,0.502,0.761));
+            nvgRect(ctx, c0x-1, c0y, 2, lh+1);
+        } else {
+            nvgFillColor(ctx, caretcolor);
+            if (c0r == c1r) {
+                nvgRect(ctx, c0x-1, c0y, c1x-c0x+1, lh+1);
+            } else {
+                int blk=c1r-c0r-1;
+                nvgRect(ctx, c0x-1, c0y, x+w-c0x+1, lh+1);
+                nvgRect(ctx, x, c1y, c1x-x+1, lh+1);
+
+                if (blk)
+                    nvgRect(ctx, x, c0y+lh, w, blk*lh+1);
+            }
+        }
+        nvgFill(ctx);
+    }
+
+    nvgBeginPath(ctx);
+    nvgFillColor(ctx, color);
+    bnd_label_rows(ctx, label, x, y, BND_LEFT);
+    BND_STATS_EXIT();
 }
 
 void bndCheck(NVGcontext *ctx, float ox, float oy, NVGcolor color) {
+    BND_STATS_ENTER();
     nvgBeginPath(ctx);
     nvgStrokeWidth(ctx,2);
     nvgStrokeColor(ctx,color);
@@ -1160,9 +2230,11 @@ void bndCheck(NVGcontext *ctx, float ox, float oy, NVGcolor color) {
     nvgLineTo(ctx,ox+7,oy+8);
     nvgLineTo(ctx,ox+14,oy+1);
     nvgStroke(ctx);
+    BND_STATS_EXIT();
 }
 
 void bndArrow(NVGcontext *ctx, float x, float y, float s, NVGcolor color) {
+    BND_STATS_ENTER();
     nvgBeginPath(ctx);
     nvgMoveTo(ctx,x,y);
     nvgLineTo(ctx,x-s,y+s);
@@ -1170,10 +2242,12 @@ void bndArrow(NVGcontext *ctx, float x, float y, float s, NVGcolor color) {
     nvgClosePath(ctx);
     nvgFillColor(ctx,color);
     nvgFill(ctx);
+    BND_STATS_EXIT();
 }
 
 void bndUpDownArrow(NVGcontext *ctx, float x, float y, float s, NVGcolor color) {
     float w;
+    BND_STATS_ENTER();
 
     nvgBeginPath(ctx);
     w = 1.1f*s;
@@ -1187,10 +2261,12 @@ void bndUpDownArrow(NVGcontext *ctx, float x, float y, float s, NVGcolor color)
     nvgClosePath(ctx);
     nvgFillColor(ctx,color);
     nvgFill(ctx);
+    BND_STATS_EXIT();
 }
 
 void bndNodeArrowDown(NVGcontext *ctx, float x, float y, float s, NVGcolor color) {
     float w;
+    BND_STATS_ENTER();
     nvgBeginPath(ctx);
     w = 1.0f*s;
     nvgMoveTo(ctx,x,y);
@@ -1199,6 +2275,7 @@ void bndNodeArrowDown(NVGcontext *ctx, float x, float y, float s, NVGcolor color
     nvgClosePath(ctx);
     nvgFillColor(ctx,color);
     nvgFill(ctx);
+    BND_STATS_EXIT();
 }
 
 void bndScrollHandleRect(float *x, float *y, float *w, float *h,
@@ -1224,3 +2301,317 @@ NVGcolor bndNodeWireColor(const BNDnodeTheme *theme, BNDwidgetState state) {
         case BND_ACTIVE: return theme->activeNodeColor;
     }
 }
+
+////////////////////////////////////////////////////////////////////////////////
+
+// a grid cell entry of a wire or port
+typedef struct BNDindexNode {
+    // cell coordinates
+    int cx, cy;
+    // wire id*2 or port id*2+1; -1 if the node is free
+    int item;
+    // neighbours in the bucket list
+    int prev, next;
+    // next node of the same item, or the next free node
+    int sibling;
+} BNDindexNode;
+
+typedef struct BNDindexItem {
+    // wire endpoints and control point offset; ports only use x0,y0
+    float x0, y0, x1, y1, delta;
+    // first grid node of the item; -1 if the item is not indexed
+    int first;
+    // query the item was last visited by
+    unsigned int stamp;
+} BNDindexItem;
+
+struct BNDwireIndex {
+    float cellsize;
+    BNDindexItem *wires;
+    int wirecount;
+    BNDindexItem *ports;
+    int portcount;
+    BNDindexNode *nodes;
+    int nodecount;
+    int nodecapacity;
+    int freenode;
+    // number of nodes in use
+    int livecount;
+    int *buckets;
+    int bucketcount;
+    unsigned int stamp;
+};
+
+static unsigned int bnd_index_hash(int cx, int cy) {
+    return ((unsigned int)cx*73856093u) ^ ((unsigned int)cy*19349663u);
+}
+
+static void bnd_index_link(BNDwireIndex *index, int n) {
+    BNDindexNode *node = &index->nodes[n];
+    int *bucket = &index->buckets[
+        bnd_index_hash(node->cx, node->cy) & (index->bucketcount-1)];
+    node->prev = -1;
+    node->next = *bucket;
+    if (*bucket >= 0)
+        index->nodes[*bucket].prev = n;
+    *bucket = n;
+}
+
+static void bnd_index_unlink(BNDwireIndex *index, int n) {
+    BNDindexNode *node = &index->nodes[n];
+    if (node->prev >= 0) {
+        index->nodes[node->prev].next = node->next;
+    } else {
+        index->buckets[bnd_index_hash(node->cx, node->cy)
+            & (index->bucketcount-1)] = node->next;
+    }
+    if (node->next >= 0)
+        index->nodes[node->next].prev = node->prev;
+}
+
+// doubles the bucket table and relinks all nodes in use
+static void bnd_index_rehash(BNDwireIndex *index) {
+    int count = index->bucketcount*2;
+    int *buckets = (int *)realloc(index->buckets, sizeof(int)*count);
+    int i;
+    if (!buckets) return;
+    index->buckets = buckets;
+    index->bucketcount = count;
+    for (i = 0; i < count; ++i)
+        buckets[i] = -1;
+    for (i = 0; i < index->nodecount; ++i) {
+        if (index->nodes[i].item >= 0)
+            bnd_index_link(index, i);
+    }
+}
+
+// enters item into cell (cx,cy) unless it is already there
+static void bnd_index_add(BNDwireIndex *index, int item, int *first,
+    int cx, int cy) {
+    int n = index->buckets[bnd_index_hash(cx, cy) & (index->bucketcount-1)];
+    BNDindexNode *node;
+    while (n >= 0) {
+        node = &index->nodes[n];
+        if ((node->item == item) && (node->cx == cx) && (node->cy == cy))
+            return;
+        n = node->next;
+    }
+    if (index->freenode >= 0) {
+        n = index->freenode;
+        index->freenode = index->nodes[n].sibling;
+    } else {
+        if (index->nodecount == index->nodecapacity) {
+            int capacity = index->nodecapacity?index->nodecapacity*2:64;
+            BNDindexNode *nodes = (BNDindexNode *)realloc(index->nodes,
+                sizeof(BNDindexNode)*capacity);
+            if (!nodes) return;
+            index->nodes = nodes;
+            index->nodecapacity = capacity;
+        }
+        n = index->nodecount++;
+    }
+    node = &index->nodes[n];
+    node->cx = cx;
+    node->cy = cy;
+    node->item = item;
+    node->sibling = *first;
+    *first = n;
+    bnd_index_link(index, n);
+    if (++index->livecount > index->bucketcount*2)
+        bnd_index_rehash(index);
+}
+
+// removes all grid nodes of an item
+static void bnd_index_remove(BNDwireIndex *index, BNDindexItem *item) {
+    int n = item->first;
+    while (n >= 0) {
+        BNDindexNode *node = &index->nodes[n];
+        int next = node->sibling;
+        bnd_index_unlink(index, n);
+        node->item = -1;
+        node->sibling = index->freenode;
+        index->freenode = n;
+        index->livecount--;
+        n = next;
+    }
+    item->first = -1;
+}
+
+// returns the item with the given id, growing the table if needed
+static BNDindexItem *bnd_index_item(BNDindexItem **items, int *count, int id) {
+    if (id < 0) return NULL;
+    if (id >= *count) {
+        int capacity = *count?*count:64;
+        BNDindexItem *newitems;
+        int i;
+        while (capacity <= id)
+            capacity *= 2;
+        newitems = (BNDindexItem *)realloc(*items,
+            sizeof(BNDindexItem)*capacity);
+        if (!newitems) return NULL;
+        for (i = *count; i < capacity; ++i) {
+            newitems[i].first = -1;
+            newitems[i].stamp = 0;
+        }
+        *items = newitems;
+        *count = capacity;
+    }
+    return &(*items)[id];
+}
+
+BNDwireIndex *bndCreateWireIndex(float cellsize) {
+    BNDwireIndex *index = (BNDwireIndex *)calloc(1, sizeof(BNDwireIndex));
+    int i;
+    if (!index) return NULL;
+    index->cellsize = (cellsize > 0)?cellsize:BND_WIRE_INDEX_CELL_SIZE;
+    index->freenode = -1;
+    index->bucketcount = 256;
+    index->buckets = (int *)malloc(sizeof(int)*index->bucketcount);
+    if (!index->buckets) {
+        free(index);
+        return NULL;
+    }
+    for (i = 0; i < index->bucketcount; ++i)
+        index->buckets[i] = -1;
+    return index;
+}
+
+void bndDestroyWireIndex(BNDwireIndex *index) {
+    if (!index) return;
+    free(index->wires);
+    free(index->ports);
+    free(index->nodes);
+    free(index->buckets);
+    free(index);
+}
+
+void bndWireIndexSetWire(BNDwireIndex *index, int id,
+    float x0, float y0, float x1, float y1) {
+    float pts[2*(BND_NODE_WIRE_MAX_SEGMENTS+1)];
+    float curving = (float)bnd_context->theme.nodeTheme.noodleCurving/10.0f;
+    float cs = index->cellsize;
+    float pad = BND_NODE_WIRE_TOLERANCE;
+    BNDindexItem *wire = bnd_index_item(&index->wires, &index->wirecount, id);
+    int i, n, cx, cy;
+    if (!wire) return;
+    bnd_index_remove(index, wire);
+    wire->x0 = x0;
+    wire->y0 = y0;
+    wire->x1 = x1;
+    wire->y1 = y1;
+    wire->delta = bnd_fmaxf(fabsf(x1 - x0),fabsf(y1 - y0))*curving;
+
+    // enter the cells covered by the bounds of each flattened segment
+    n = bnd_wire_segments(x0, y0, x1, y1, wire->delta, 1);
+    bnd_flatten_wire(pts, n, x0, y0, x1, y1, wire->delta);
+    for (i = 0; i < n; ++i) {
+        const float *p = pts + 2*i;
+        int cx0 = (int)floorf((bnd_fminf(p[0], p[2]) - pad)/cs);
+        int cy0 = (int)floorf((bnd_fminf(p[1], p[3]) - pad)/cs);
+        int cx1 = (int)floorf((bnd_fmaxf(p[0], p[2]) + pad)/cs);
+        int cy1 = (int)floorf((bnd_fmaxf(p[1], p[3]) + pad)/cs);
+        for (cy = cy0; cy <= cy1; ++cy) {
+            for (cx = cx0; cx <= cx1; ++cx)
+                bnd_index_add(index, id*2, &wire->first, cx, cy);
+        }
+    }
+}
+
+void bndWireIndexRemoveWire(BNDwireIndex *index, int id) {
+    if ((id < 0) || (id >= index->wirecount)) return;
+    bnd_index_remove(index, &index->wires[id]);
+}
+
+void bndWireIndexSetPort(BNDwireIndex *index, int id, float x, float y) {
+    BNDindexItem *port = bnd_index_item(&index->ports, &index->portcount, id);
+    if (!port) return;
+    bnd_index_remove(index, port);
+    port->x0 = x;
+    port->y0 = y;
+    bnd_index_add(index, id*2+1, &port->first,
+        (int)floorf(x/index->cellsize), (int)floorf(y/index->cellsize));
+}
+
+void bndWireIndexRemovePort(BNDwireIndex *index, int id) {
+    if ((id < 0) || (id >= index->portcount)) return;
+    bnd_index_remove(index, &index->ports[id]);
+}
+
+// returns the distance of (px,py) to the wire flattened as by
+// bnd_wire_segments(), which is not the exact distance to the curve
+static float bnd_wire_distance(const BNDindexItem *wire, float px, float py) {
+    float pts[2*(BND_NODE_WIRE_MAX_SEGMENTS+1)];
+    float d = INFINITY;
+    int i, n = bnd_wire_segments(wire->x0, wire->y0, wire->x1, wire->y1,
+        wire->delta, 1);
+    bnd_flatten_wire(pts, n, wire->x0, wire->y0, wire->x1, wire->y1,
+        wire->delta);
+    for (i = 0; i < n; ++i) {
+        const float *p = pts + 2*i;
+        float sx = p[2] - p[0];
+        float sy = p[3] - p[1];
+        float ll = sx*sx + sy*sy;
+        float t = (ll > 0)?bnd_clamp(((px - p[0])*sx + (py - p[1])*sy)/ll,
+            0, 1):0;
+        float dx = p[0] + t*sx - px;
+        float dy = p[1] + t*sy - py;
+        d = bnd_fminf(d, dx*dx + dy*dy);
+    }
+    return sqrtf(d);
+}
+
+// visits all indexed items of the given kind near (px,py) and returns the
+// closest one within maxdist
+static int bnd_index_find(BNDwireIndex *index, int kind,
+    float px, float py, float maxdist, float *dist) {
+    float cs = index->cellsize;
+    int cx0 = (int)floorf((px - maxdist)/cs);
+    int cy0 = (int)floorf((py - maxdist)/cs);
+    int cx1 = (int)floorf((px + maxdist)/cs);
+    int cy1 = (int)floorf((py + maxdist)/cs);
+    int cx, cy, best = -1;
+    float bestd = maxdist;
+    unsigned int stamp = ++index->stamp;
+    for (cy = cy0; cy <= cy1; ++cy) {
+        for (cx = cx0; cx <= cx1; ++cx) {
+            int n = index->buckets[bnd_index_hash(cx, cy)
+                & (index->bucketcount-1)];
+            for (; n >= 0; n = index->nodes[n].next) {
+                const BNDindexNode *node = &index->nodes[n];
+                BNDindexItem *item;
+                float d;
+                if ((node->cx != cx) || (node->cy != cy)
+                    || ((node->item & 1) != kind))
+                    continue;
+                item = kind?&index->ports[node->item>>1]
+                    :&index->wires[node->item>>1];
+                if (item->stamp == stamp) continue;
+                item->stamp = stamp;
+                if (kind) {
+                    float dx = item->x0 - px;
+                    float dy = item->y0 - py;
+                    d = sqrtf(dx*dx + dy*dy);
+                } else {
+                    d = bnd_wire_distance(item, px, py);
+                }
+                if (d <= bestd) {
+                    bestd = d;
+                    best = node->item>>1;
+                }
+            }
+        }
+    }
+    if (dist && (best >= 0))
+        *dist = bestd;
+    return best;
+}
+
+int bndWireIndexFindWire(BNDwireIndex *index, float px, float py,
+    float maxdist, float *dist) {
+    return bnd_index_find(index, 0, px, py, maxdist, dist);
+}
+
+int bndWireIndexFindPort(BNDwireIndex *index, float px, float py,
+    float maxdist, float *dist) {
+    return bnd_index_find(index, 1, px, py, maxdist, dist);
+}
@@ -163,6 +163,17 @@ typedef struct BNDtheme {
     BNDnodeTheme nodeTheme;
 } BNDtheme;
 
+// opaque handle to a blendish context; see bndCreateContext()
+typedef struct BNDcontext BNDcontext;
+
+// opaque handle to a spatial index of node wires and ports; see
+// bndCreateWireIndex()
+typedef struct BNDwireIndex BNDwireIndex;
+
+// opaque handle to a label whose line breaks and glyph positions have been
+// computed in advance; see bndCreateLabel()
+typedef struct BNDlabel BNDlabel;
+
 // how text on a control is aligned
 typedef enum BNDtextAlignment {
     BND_LEFT = 0,
@@ -322,6 +333,34 @@ typedef enum BNDcornerFlags {
 // max rows for position testing
 #define BND_MAX_ROWS 32
 
+// transform scales below which, if level of detail reduction is enabled,
+// text and icons, then gradients and drop shadows, then rounded corners and
+// outlines are no longer drawn
+#define BND_LOD_TEXT_SCALE 0.5f
+#define BND_LOD_GRADIENT_SCALE 0.3f
+#define BND_LOD_CORNER_SCALE 0.15f
+
+// default grid cell size of a wire index
+#define BND_WIRE_INDEX_CELL_SIZE 32
+
+// number of text measurements kept by the text bounds cache; the least
+// recently used measurement is discarded when the cache is full
+#ifndef BND_TEXT_CACHE_SIZE
+#define BND_TEXT_CACHE_SIZE 512
+#endif
+
+// texts are stored in the text bounds cache to tell them apart; longer
+// texts are measured every time
+#ifndef BND_TEXT_CACHE_MAX_LENGTH
+#define BND_TEXT_CACHE_MAX_LENGTH 47
+#endif
+
+// number of blendish functions whose nanovg calls are counted separately
+// when built with BLENDISH_STATS
+#ifndef BND_MAX_STATS_ENTRIES
+#define BND_MAX_STATS_ENTRIES 128
+#endif
+
 // text distance from bottom
 #define BND_TEXT_PAD_DOWN 7
 
@@ -329,6 +368,10 @@ typedef enum BNDcornerFlags {
 #define BND_NODE_WIRE_OUTLINE_WIDTH 4
 // stroke width of wire
 #define BND_NODE_WIRE_WIDTH 2
+// maximum distance in pixels between a flattened wire and its curve
+#define BND_NODE_WIRE_TOLERANCE 0.25f
+// maximum number of line segments per flattened wire
+#define BND_NODE_WIRE_MAX_SEGMENTS 64
 // radius of node box
 #define BND_NODE_RADIUS 8
 // feather of node title text
@@ -837,8 +880,35 @@ typedef enum BNDicon {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-// set the current theme all widgets will be drawn with.
+// create a new blendish context, which holds its own theme, UI font, icon
+// sheet, text bounds cache and text layout scratch buffers. The new context
+// starts out with the initial theme and without a font or icon sheet, since
+// those belong to an NVGcontext; set them with bndSetFont() and
+// bndSetIconImage().
+// The context is managed by the client and must be released using
+// bndDestroyContext(). Returns NULL if the context could not be allocated.
+BND_EXPORT BNDcontext *bndCreateContext();
+
+// select a blendish context as the current context of the calling thread;
+// all other functions operate on the current context. Passing NULL selects
+// the default context, which is current for every thread that has not
+// selected a context. The default context is shared by all those threads
+// and is not synchronized, so threads that draw in parallel must each
+// select a context of their own.
+BND_EXPORT void bndMakeCurrent(BNDcontext *ctx);
+
+// release the memory of a context created with bndCreateContext(); if the
+// context is current on the calling thread, the default context will be
+// selected. The default context can not be destroyed.
+BND_EXPORT void bndDestroyContext(BNDcontext *ctx);
+
+// returns the context that is current on the calling thread
+BND_EXPORT BNDcontext *bndGetContext();
+
+// set the theme all widgets of the current context will be drawn with.
 // the default Blender 2.6 theme is set by default.
+// the widget colors for every theme and state are computed once here, so
+// drawing widgets only has to look them up.
 BND_EXPORT void bndSetTheme(BNDtheme theme);
 
 // Returns the currently set theme
@@ -855,8 +925,89 @@ BND_EXPORT void bndSetIconImage(int image);
 // UI font. Blender's original UI font Droid Sans is perfectly suited and
 // available here:
 // https://svn.blender.org/svnroot/bf-blender/trunk/blender/release/datafiles/fonts/
+// Setting the font also clears the text bounds cache.
 BND_EXPORT void bndSetFont(int font);
 
+// discards all text measurements kept by the text bounds cache of the
+// current context; call this when fonts have been modified without calling
+// bndSetFont().
+BND_EXPORT void bndClearTextCache();
+
+// enable or disable level of detail reduction for the current context;
+// disabled by default. When enabled, widgets drawn with a transform that
+// scales them below BND_LOD_TEXT_SCALE are drawn without text and icons,
+// below BND_LOD_GRADIENT_SCALE also with flat colors and without drop
+// shadows, and below BND_LOD_CORNER_SCALE as plain filled rectangles.
+BND_EXPORT void bndSetLevelOfDetail(int enabled);
+
+// enable or disable shared box paths for the current context; disabled by
+// default. When enabled, widgets build the rounded box path once, fill it
+// and stroke the outline from it, instead of building a second path for the
+// outline. The fill then uses the outline geometry: it is inset by half a
+// pixel instead of one and keeps the full corner radius, so the inner part
+// reaches half a pixel further under the outline.
+BND_EXPORT void bndSetSharedBoxPaths(int enabled);
+
+#ifdef BLENDISH_STATS
+
+// kinds of nanovg calls counted when blendish is built with BLENDISH_STATS
+typedef enum BNDstat {
+    // nvgBeginPath()
+    BND_STAT_PATHS = 0,
+    // nvgFill()
+    BND_STAT_FILLS,
+    // nvgStroke()
+    BND_STAT_STROKES,
+    // nvgFillColor(), nvgStrokeColor()
+    BND_STAT_COLOR_PAINTS,
+    // nvgLinearGradient()
+    BND_STAT_LINEAR_GRADIENTS,
+    // nvgBoxGradient()
+    BND_STAT_BOX_GRADIENTS,
+    // nvgImagePattern()
+    BND_STAT_IMAGE_PATTERNS,
+    // nvgScissor(), nvgResetScissor()
+    BND_STAT_SCISSORS,
+    // nvgText(), nvgTextBox()
+    BND_STAT_TEXT_RUNS,
+    // nvgTextBounds(), nvgTextBoxBounds(), nvgTextBreakLines(),
+    // nvgTextGlyphPositions(), nvgTextMetrics()
+    BND_STAT_TEXT_MEASUREMENTS,
+    // changes of stroke, font and transform state, nvgSave(), nvgRestore()
+    BND_STAT_STATE_CHANGES,
+
+    BND_STAT_COUNT
+} BNDstat;
+
+// nanovg calls made by blendish since the last call to bndResetStats()
+typedef struct BNDstats {
+    // name of the blendish function that made the calls, or NULL for the
+    // totals of all functions
+    const char *function;
+    // number of calls, indexed by BNDstat
+    int counts[BND_STAT_COUNT];
+} BNDstats;
+
+// reset all counters of the current context; call this once per frame,
+// before drawing.
+BND_EXPORT void bndResetStats();
+
+// returns the totals of all nanovg calls counted since bndResetStats()
+BND_EXPORT const BNDstats *bndGetStats();
+
+// returns the number of blendish functions that made nanovg calls since
+// bndResetStats(). Calls are attributed to the public function called by
+// the application, so the calls bndToolButton() makes through
+// bndInnerOutlineBox() and other helpers are counted as its own.
+// Functions beyond BND_MAX_STATS_ENTRIES are only counted in the totals.
+BND_EXPORT int bndGetStatsCount();
+
+// returns the calls made by the function at index, where
+// 0 <= index < bndGetStatsCount()
+BND_EXPORT const BNDstats *bndGetStatsEntry(int index);
+
+#endif // BLENDISH_STATS
+
 ////////////////////////////////////////////////////////////////////////////////
 
 // High Level Functions
@@ -1010,6 +1161,17 @@ BND_EXPORT void bndNodeWire(NVGcontext *ctx, float x0, float y0, float x1, float
 BND_EXPORT void bndColoredNodeWire(NVGcontext *ctx, float x0, float y0, float x1, float y1,
     NVGcolor color0, NVGcolor color1);
 
+// Draw count node wires at once; points holds four coordinates x0,y0,x1,y1
+// per wire and colors holds two colors color0,color1 per wire, as they would
+// be passed to bndColoredNodeWire(). Wires sharing the same solid color are
+// built as one path of beziers, which is stroked once as outline and once as
+// core, so a whole layer of cables needs only a few draw calls. The groups
+// are drawn in the order of their colors, followed by the wires with two
+// different colors, which are drawn one by one with a gradient core in the
+// order they were passed.
+BND_EXPORT void bndColoredNodeWires(NVGcontext *ctx, int count,
+    const float *points, const NVGcolor *colors);
+
 // Draw a node background with its upper left origin at (x,y) and size of (w,h)
 // where titleColor provides the base color for the title bar
 BND_EXPORT void bndNodeBackground(NVGcontext *ctx, float x, float y, float w, float h,
@@ -1119,6 +1281,14 @@ BND_EXPORT void bndInnerBox(NVGcontext *ctx, float x, float y, float w, float h,
 BND_EXPORT void bndOutlineBox(NVGcontext *ctx, float x, float y, float w, float h,
     float cr0, float cr1, float cr2, float cr3, NVGcolor color);
 
+// Draw the inner part and the outline of a widget box in one go; same as
+// bndInnerBox() followed by bndOutlineBox(), but the level of detail is
+// looked up only once for both. If shared box paths are enabled (see
+// bndSetSharedBoxPaths()), the box path is built only once.
+BND_EXPORT void bndInnerOutlineBox(NVGcontext *ctx, float x, float y, float w, float h,
+    float cr0, float cr1, float cr2, float cr3,
+    NVGcolor shade_top, NVGcolor shade_down, NVGcolor outline);
+
 // Draw an optional icon specified by <iconid> and an optional label with
 // given alignment (BNDtextAlignment), fontsize and color within a widget box.
 // if iconid is >= 0, an icon will be drawn and the labels remaining space
@@ -1159,6 +1329,47 @@ BND_EXPORT void bndIconLabelCaret(NVGcontext *ctx, float x, float y, float w, fl
     int iconid, NVGcolor color, float fontsize, const char *label,
     NVGcolor caretcolor, int cbegin, int cend);
 
+// Create a prepared label for text that rarely changes. The text is copied,
+// broken into rows at the given break width and its glyph positions, bounds
+// and metrics are computed once with the current UI font and the given
+// fontsize. If width is < 0, shaping is deferred until the label is first
+// drawn. The bndPrepared*() functions re-shape the label only when the
+// available width or the UI font changes.
+// Returns NULL if the label could not be allocated.
+BND_EXPORT BNDlabel *bndCreateLabel(NVGcontext *ctx, const char *text,
+    float fontsize, float width);
+
+// Free a label created with bndCreateLabel(); label may be NULL.
+BND_EXPORT void bndDestroyLabel(BNDlabel *label);
+
+// Returns the text of a prepared label
+BND_EXPORT const char *bndGetLabelText(const BNDlabel *label);
+
+// Same as bndIconLabelValue(), but takes prepared labels for label and value;
+// either may be NULL. The fontsize is the one the labels were created with.
+// The widget height is implied by BND_WIDGET_HEIGHT and not passed.
+BND_EXPORT void bndPreparedIconLabelValue(NVGcontext *ctx,
+    float x, float y, float w, int iconid, NVGcolor color, int align,
+    BNDlabel *label, BNDlabel *value);
+
+// Same as bndNodeIconLabel(), but takes a prepared label. The title is
+// always left aligned, so no alignment is passed.
+BND_EXPORT void bndPreparedNodeIconLabel(NVGcontext *ctx,
+    float x, float y, float w, float h, int iconid, NVGcolor color,
+    NVGcolor shadowColor, BNDlabel *label);
+
+// Same as bndIconLabelTextPosition(), but takes a prepared label and no
+// widget height.
+BND_EXPORT int bndPreparedIconLabelTextPosition(NVGcontext *ctx,
+    float x, float y, float w, int iconid, BNDlabel *label,
+    int px, int py);
+
+// Same as bndIconLabelCaret(), but takes a prepared label and no widget
+// height.
+BND_EXPORT void bndPreparedIconLabelCaret(NVGcontext *ctx,
+    float x, float y, float w, int iconid, NVGcolor color,
+    BNDlabel *label, NVGcolor caretcolor, int cbegin, int cend);
+
 // Draw a checkmark for an option box with the given upper left coordinates
 // (ox,oy) with the specified color.
 BND_EXPORT void bndCheck(NVGcontext *ctx, float ox, float oy, NVGcolor color);
@@ -1178,6 +1389,55 @@ BND_EXPORT void bndNodeArrowDown(NVGcontext *ctx, float x, float y, float s, NVG
 // BND_ACTIVE indicates dragged state
 BND_EXPORT NVGcolor bndNodeWireColor(const BNDnodeTheme *theme, BNDwidgetState state);
 
+////////////////////////////////////////////////////////////////////////////////
+
+// Hit Testing
+// -----------
+// A wire index stores node wires and ports in a hashed uniform grid, so
+// the wire or port under the cursor can be found without testing every
+// wire. Wires and ports are identified by ids chosen by the client; ids
+// should be small non-negative integers, as tables are sized by the largest
+// id in use. Moving a single wire or port only updates that entry.
+
+// create an empty wire index with the given grid cell size in pixels; pass
+// 0 to use BND_WIRE_INDEX_CELL_SIZE. The index must be released using
+// bndDestroyWireIndex(). Returns NULL if the index could not be allocated.
+BND_EXPORT BNDwireIndex *bndCreateWireIndex(float cellsize);
+
+// release the memory of a wire index; index may be NULL.
+BND_EXPORT void bndDestroyWireIndex(BNDwireIndex *index);
+
+// insert or move the wire with the given id, originating at (x0,y0) and
+// floating to (x1,y1), using the noodleCurving of the current theme like
+// bndNodeWire() does.
+BND_EXPORT void bndWireIndexSetWire(BNDwireIndex *index, int id,
+    float x0, float y0, float x1, float y1);
+
+// remove the wire with the given id from the index
+BND_EXPORT void bndWireIndexRemoveWire(BNDwireIndex *index, int id);
+
+// insert or move the port with the given id, centered at (x,y)
+BND_EXPORT void bndWireIndexSetPort(BNDwireIndex *index, int id,
+    float x, float y);
+
+// remove the port with the given id from the index
+BND_EXPORT void bndWireIndexRemovePort(BNDwireIndex *index, int id);
+
+// returns the id of the wire closest to (px,py) that is at most maxdist
+// pixels away, or -1 if there is none. If dist is not NULL and a wire was
+// found, the distance to the wire is stored in dist. Distances are measured
+// to the wire flattened into line segments, which stay within
+// BND_NODE_WIRE_TOLERANCE of the curve unless the wire is long enough to
+// need more than BND_NODE_WIRE_MAX_SEGMENTS of them.
+BND_EXPORT int bndWireIndexFindWire(BNDwireIndex *index, float px, float py,
+    float maxdist, float *dist);
+
+// returns the id of the port whose center is closest to (px,py) and at most
+// maxdist pixels away, or -1 if there is none. If dist is not NULL and a port
+// was found, the distance to its center is stored in dist.
+BND_EXPORT int bndWireIndexFindPort(BNDwireIndex *index, float px, float py,
+    float maxdist, float *dist);
+
 #ifdef __cplusplus
 };
 #endif
@@ -220,8 +220,8 @@ void drawUI(NVGcontext *vg, int item, int corners) {
             case ST_SLIDER:{
                 const UISliderData *data = (UISliderData*)head;
                 BNDwidgetState state = (BNDwidgetState)uiGetState(item);
-                static char value[32];
-                sprintf(value,"%.0f%%",(*data->progress)*100.0f);
+                const char *value = uiFormat("%.0f%%",
+                    (*data->progress)*100.0f);
                 bndSlider(vg,rect.x,rect.y,rect.w,rect.h,
                         corners,state,
                     *data->progress,data->label,value);
@@ -258,10 +258,15 @@ void layout_window(int w, int h) {
 #define OUI_USE_UNION_VECTORS 1
 #endif
 
+// #define OUI_COMPACT_ITEMS for the implementation to keep item handles in an
+// array of their own; on 64-bit targets, this shrinks the items that layout
+// and hit testing walk from 32 to 24 bytes.
+
 // limits
 
 enum {
-    // maximum size in bytes of a single data buffer passed to uiAllocData().
+    // maximum size in bytes of a single data buffer passed to uiAllocData();
+    // larger handles are allocated from separate chunks by uiAllocHandle().
     UI_MAX_DATASIZE = 4096,
     // maximum depth of nested containers
     UI_MAX_DEPTH = 64,
@@ -269,6 +274,17 @@ enum {
     UI_MAX_INPUT_EVENTS = 64,
     // consecutive click threshold in ms
     UI_CLICK_THRESHOLD = 250,
+    // maximum number of dirty rectangles reported per frame
+    UI_MAX_DIRTY_RECTS = 16,
+    // maximum number of placeholders that can be invalidated per frame;
+    // beyond that, all placeholders are invalidated
+    UI_MAX_INVALID_PLACEHOLDERS = 16,
+    // number of frames a persistent block is kept after its item could not
+    // be mapped to a new item
+    UI_PERSISTENT_LIFETIME = 60,
+    // maximum number of columns in a UI_GRID container; further cells of a
+    // row wrap to a new row
+    UI_MAX_GRID_COLUMNS = 32,
 };
 
 typedef unsigned int UIuint;
@@ -276,6 +292,14 @@ typedef unsigned int UIuint;
 // opaque UI context
 typedef struct UIcontext UIcontext;
 
+// flags for uiCreateContextEx(), uiContextFootprint() and
+// uiCreateContextInPlace()
+typedef enum UIcontextFlags {
+    // keep the declaration of each frame for uiReuseItem() and
+    // uiPlaceholder(); takes sizeof(UIitem) more bytes per item
+    UI_CONTEXT_REUSE = 1,
+} UIcontextFlags;
+
 // item states as returned by uiGetState()
 
 typedef enum UIitemState {
@@ -304,12 +328,20 @@ typedef enum UIboxFlags {
     UI_LAYOUT = 0x000,
     // flex model
     UI_FLEX = 0x002,
+    // grid model; children are placed in columns from left to right,
+    // UI_BREAK starts a new row, as does a cell past UI_MAX_GRID_COLUMNS.
+    // columns and rows are as large as their largest cell; columns with
+    // UI_HFILL cells and rows with UI_VFILL cells share the remaining space
+    // of the container.
+    UI_GRID = 0x001,
 
     // flex-wrap (bit 2)
 
     // single-line
     UI_NOWRAP = 0x000,
-    // multi-line, wrap left to right
+    // multi-line, wrap left to right. line breaks are kept from frame to
+    // frame and only found again from the first line whose children or
+    // breaks change, e.g. while the container is resized
     UI_WRAP = 0x004,
 
 
@@ -360,8 +392,9 @@ typedef enum UIlayoutFlags {
     UI_CENTER = 0x000,
     // anchor to all four directions
     UI_FILL = 0x1e0,
-    // when wrapping, put this element on a new line
-    // wrapping layout code auto-inserts UI_BREAK flags,
+    // when wrapping, put this element on a new line;
+    // in a UI_GRID container, start a new row with this element.
+    // wrapping and grid layout code auto-inserts UI_BREAK flags,
     // drawing routines can read them with uiGetLayout()
     UI_BREAK = 0x200
 } UIlayoutFlags;
@@ -412,6 +445,10 @@ enum {
 // handler callback; event is one of UI_EVENT_*
 typedef void (*UIhandler)(int item, UIevent event);
 
+// measure callback; returns the size of the contents of item in dimension dim
+// (0: width, 1: height)
+typedef int (*UImeasureHandler)(int item, int dim);
+
 // for cursor positions, mainly
 typedef struct UIvec2 {
 #if OUI_USE_UNION_VECTORS || defined(OUI_IMPLEMENTATION)
@@ -446,13 +483,49 @@ typedef struct UIrect {
 // using uiDestroyContext()
 // item_capacity is the maximum of number of items that can be declared.
 // buffer_capacity is the maximum total size of bytes that can be allocated
-// using uiAllocHandle(); you may pass 0 if you don't need to allocate
-// handles.
+// using uiAllocHandle(), where each allocation takes its alignment padding
+// and, while damage tracking (see uiSetDamageTracking()) or item reuse is
+// in use, sizeof(unsigned int) additional bytes; handles that don't fit are
+// allocated from separate chunks. You may pass 0 if you don't need to
+// allocate handles.
 // 4096 and (1<<20) are good starting values.
 OUI_EXPORT UIcontext *uiCreateContext(
         unsigned int item_capacity,
         unsigned int buffer_capacity);
 
+// like uiCreateContext(), with a combination of UIcontextFlags; e.g. pass
+// UI_CONTEXT_REUSE to use uiReuseItem() and uiPlaceholder().
+OUI_EXPORT UIcontext *uiCreateContextEx(
+        unsigned int item_capacity,
+        unsigned int buffer_capacity,
+        unsigned int flags);
+
+// returns the size in bytes of the memory block required to create a context
+// with uiCreateContextInPlace() for the given capacities and flags
+OUI_EXPORT unsigned int uiContextFootprint(
+        unsigned int item_capacity,
+        unsigned int buffer_capacity,
+        unsigned int flags);
+
+// like uiCreateContextEx(), but the context is placed in the memory block of
+// size bytes provided by the caller, which must be at least
+// uiContextFootprint(item_capacity, buffer_capacity, flags) bytes large and
+// aligned to 8 bytes. The block holds the items, handle buffers and
+// wrapped lines of this and the last frame, sized for item_capacity items.
+// uiDestroyContext() releases what the context has allocated itself, but
+// not memory; no heap allocation is made as long as persistent blocks,
+// interned strings and handles outside the buffer (see uiAllocHandle())
+// aren't used.
+// When OUI_STATIC_CONTEXT is defined for the implementation,
+// uiCreateContextEx() places its single context in static storage for
+// OUI_STATIC_ITEM_CAPACITY items, a buffer of OUI_STATIC_BUFFER_CAPACITY
+// bytes and the flags in OUI_STATIC_CONTEXT_FLAGS in the same way.
+OUI_EXPORT UIcontext *uiCreateContextInPlace(
+        void *memory, unsigned int size,
+        unsigned int item_capacity,
+        unsigned int buffer_capacity,
+        unsigned int flags);
+
 // select an UI context as the current context; a context must always be 
 // selected before using any of the other UI functions
 OUI_EXPORT void uiMakeCurrent(UIcontext *ctx);
@@ -535,6 +608,8 @@ OUI_EXPORT UIvec2 uiGetScroll();
 OUI_EXPORT void uiBeginLayout();
 
 // layout all added items starting from the root item 0.
+// the horizontal layout is computed first, then the vertical layout, so that
+// heights can depend on final widths (see uiSetMeasureHandler()).
 // after calling uiEndLayout(), no further modifications to the item tree should
 // be done until the next call to uiBeginLayout().
 // It is safe to immediately draw the items after a call to uiEndLayout().
@@ -555,6 +630,24 @@ OUI_EXPORT void uiUpdateHotItem();
 // this is an O(N) operation for N = number of declared items.
 OUI_EXPORT void uiProcess(int timestamp);
 
+// returns 1 if the UI may look different from the last frame drawn, otherwise
+// 0. This is the case if input has been passed in since the last call to
+// uiProcess() (see the Input Control functions), if uiProcess() changed the
+// hot, active or focused item, notified a handler or reset the click count,
+// or if uiEndLayout() reported dirty rectangles (see uiGetDirtyRectCount())
+// and uiProcess() has not been called since, i.e. they have not been drawn.
+// Repeated UI_BUTTON0_CAPTURE notifications without cursor movement are not
+// considered a change.
+// When it returns 0, the application can wait for new input events until
+// the time returned by uiGetNextDeadline() before running the next frame.
+OUI_EXPORT int uiNeedsRedraw();
+
+// returns the timestamp, in the time base passed to uiProcess(), at which
+// the UI needs to be processed again even if no input arrives, or -1 if
+// there is no such time. Currently, this is the end of the consecutive click
+// window after a click, at which uiGetClicks() is reset.
+OUI_EXPORT int uiGetNextDeadline();
+
 // reset the currently stored hot/active etc. handles; this should be called when
 // a re-declaration of the UI changes the item indices, to avoid state
 // related glitches because item identities have changed.
@@ -584,13 +677,74 @@ OUI_EXPORT void uiSetHandle(int item, void *handle);
 // as the handle to the item.
 // The memory of the pointer is managed by the UI context and released
 // upon the next call to uiBeginLayout()
+// Handles are packed without alignment; use uiAllocHandleAligned() for
+// data that requires it. Handles of UI_MAX_DATASIZE bytes or more, or that
+// don't fit into the remaining buffer, are allocated from chunks that are
+// recycled between frames.
 OUI_EXPORT void *uiAllocHandle(int item, unsigned int size);
 
+// like uiAllocHandle(), but the handle is aligned to alignment bytes, which
+// must be a power of two. Small handles only take the padding needed to
+// align them.
+OUI_EXPORT void *uiAllocHandleAligned(int item, unsigned int size,
+        unsigned int alignment);
+
+// return a block of at least size bytes that belongs to item and persists
+// across frames, e.g. for scroll offsets, expanded flags or edit cursors.
+// The block is created zeroed on first use. When uiEndLayout() maps the item
+// to a new item (see uiRecoverItem()), the block moves on to the new item;
+// blocks of items that could not be mapped are released after
+// UI_PERSISTENT_LIFETIME frames, during which their pointers remain valid.
+// Between uiBeginLayout() and uiEndLayout(), item refers to an item of the
+// last frame, as blocks are only moved to the new items by uiEndLayout().
+// If size grows beyond the capacity of the existing block, the contents are
+// moved to a larger block.
+// size must be below UI_MAX_DATASIZE. Blocks are kept in slabs per size
+// class, so that lookup is O(1) and no memory is allocated in steady state.
+OUI_EXPORT void *uiGetPersistent(int item, unsigned int size);
+
+// release the persistent block of item, if any; see uiGetPersistent()
+OUI_EXPORT void uiFreePersistent(int item);
+
+// copy text into the buffer used by uiAllocHandle() and return the copy.
+// Like handles, the string is released with the frame; it remains valid
+// until the next call to uiBeginLayout(). Strings that don't fit into the
+// buffer are allocated from separate chunks, like large handles.
+OUI_EXPORT char *uiAllocString(const char *text);
+
+// format a string like printf() directly into the buffer used by
+// uiAllocHandle() and return it; the string is allocated and released like
+// those returned by uiAllocString().
+OUI_EXPORT const char *uiFormat(const char *format, ...);
+
+// return a copy of text that keeps its address across frames; interning an
+// equal string again returns the same pointer, which keeps handles that
+// reference it unchanged for uiGetDirtyRectCount() and safe to copy with
+// uiReuseItem(). Strings are looked up by hash and released after they
+// have not been interned for UI_PERSISTENT_LIFETIME frames.
+OUI_EXPORT const char *uiIntern(const char *text);
+
 // set the global handler callback for interactive items.
 // the handler will be called for each item whose event flags are set using
 // uiSetEvents.
 OUI_EXPORT void uiSetHandler(UIhandler handler);
 
+// set the global measure callback for items without children.
+// uiEndLayout() calls the handler for every such item whose size in a
+// dimension has not been set with uiSetSize(), unless the item fills
+// (UI_HFILL/UI_VFILL) a parent whose size in that dimension has been set
+// and that stretches it regardless of its contents; grid cells and items
+// across the lines of a wrapping parent are always measured, as they set
+// the size of their column, row or line. The result is used as the
+// size of the item for the frame, as if passed to uiSetSize() but without
+// fixing it. Items are measured at most once per dimension and frame.
+// All widths are measured and arranged before any height is measured, so
+// when the handler is called with dim 1, uiGetWidth() already returns the
+// final width of the item; this allows measuring the height of wrapped text
+// for the width it will actually have (e.g. with bndLabelHeight()) within a
+// single call to uiEndLayout().
+OUI_EXPORT void uiSetMeasureHandler(UImeasureHandler handler);
+
 // flags is a combination of UI_EVENT_* and designates for which events the 
 // handler should be called. 
 OUI_EXPORT void uiSetEvents(int item, unsigned int flags);
@@ -659,7 +813,8 @@ OUI_EXPORT int uiNextSibling(int item);
 // return the total number of allocated items
 OUI_EXPORT int uiGetItemCount();
 
-// return the total bytes that have been allocated by uiAllocHandle()
+// return the total bytes that have been allocated by uiAllocHandle() from
+// the buffer, not counting separate chunks
 OUI_EXPORT unsigned int uiGetAllocSize();
 
 // return the current state of the item. This state is only valid after
@@ -689,6 +844,9 @@ OUI_EXPORT int uiFindItem(int item, int x, int y,
 
 // return the handler callback as passed to uiSetHandler()
 OUI_EXPORT UIhandler uiGetHandler();
+
+// return the measure callback as passed to uiSetMeasureHandler()
+OUI_EXPORT UImeasureHandler uiGetMeasureHandler();
 // return the event flags for an item as passed to uiSetEvents()
 OUI_EXPORT unsigned int uiGetEvents(int item);
 // return the user-defined flags for an item as passed to uiSetFlags()
@@ -745,6 +903,65 @@ OUI_EXPORT void uiRemapItem(int olditem, int newitem);
 // returns the number if items that have been allocated in the last frame
 OUI_EXPORT int uiGetLastItemCount();
 
+// declare a copy of the item olditem from the last frame, including all its
+// child items, and return the new items ID. The copy is declared exactly as
+// the old items were declared before the last call to uiEndLayout(), so the
+// code that declared them doesn't need to run again; the new item still
+// has to be inserted into a parent.
+// Handles allocated with uiAllocHandle() are copied along with their current
+// contents, other handles are copied as pointers. The copied items are
+// mapped to their originals for uiRecoverItem().
+// The context must have been created with UI_CONTEXT_REUSE, so that
+// uiEndLayout() keeps the declaration of every frame.
+// this is an O(N) operation for N = number of items in the subtree.
+OUI_EXPORT int uiReuseItem(int olditem);
+
+// declare an item without children that takes the place of the item olditem
+// from the last frame, and return the new items ID. The placeholder has the
+// margins and layout flags olditem was declared with and the size olditem
+// had after the last layout, so that e.g. the contents of a collapsed or
+// scrolled out panel don't need to be declared to arrange its siblings.
+// Returns -1 if olditem is -1 or has been invalidated with
+// uiInvalidatePlaceholder(); in that case, the contents have to be declared
+// again. Pass the returned ID as olditem in the next frame to keep the
+// placeholder. The placeholder is mapped to olditem for uiRecoverItem().
+// Like uiReuseItem(), this requires a context created with UI_CONTEXT_REUSE.
+OUI_EXPORT int uiPlaceholder(int olditem);
+
+// tell uiPlaceholder() in the next frame that the size of item is out of
+// date, e.g. because the contents it stands for have changed. Can only be
+// called between uiEndLayout() and the next uiBeginLayout().
+OUI_EXPORT void uiInvalidatePlaceholder(int item);
+
+// enable or disable damage tracking for the current context; disabled by
+// default. Takes effect with the next uiBeginLayout(). While enabled,
+// uiEndLayout() compares every item with the item it was mapped to and
+// collects the dirty rectangles of what changed, and handles allocated with
+// uiAllocHandle() take a size header so that their contents can be compared.
+// While disabled, the dirty rectangles simply cover the root items of the
+// last and the current frame. Damage is also reported that way for the
+// first frame after enabling, as the last frame has nothing to compare.
+OUI_EXPORT void uiSetDamageTracking(int enabled);
+
+// returns the number of rectangles that have to be redrawn to update the
+// previous frame to the items laid out by the last call to uiEndLayout(), or
+// 0 if the UI looks the same as in the previous frame and drawing can be
+// skipped. With damage tracking (see uiSetDamageTracking()), an item is
+// considered changed if its rectangle, state, flags or handle differ from
+// those of the item it was mapped to (see uiRecoverItem()), where the
+// contents of handles allocated with uiAllocHandle() are compared bytewise.
+// Changes of data that handles merely point to can not be detected.
+// Overlapping rectangles are merged; if there are more than
+// UI_MAX_DIRTY_RECTS, the closest ones are merged as well.
+OUI_EXPORT int uiGetDirtyRectCount();
+
+// returns the dirty rectangle at index, where
+// 0 <= index < uiGetDirtyRectCount(); see uiGetDirtyRectCount()
+// Items are compared with their mapped items one by one, so a change in the
+// draw order of siblings alone, e.g. when overlapping items are swapped,
+// produces no damage.
+OUI_EXPORT UIrect uiGetDirtyRect(int index);
+
 #ifdef __cplusplus
 };
 #endif
@@ -754,6 +971,9 @@ OUI_EXPORT int uiGetLastItemCount();
 #ifdef OUI_IMPLEMENTATION
 
 #include <assert.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
 
 #ifdef _MSC_VER
     #pragma warning (disable: 4996) // Switch off security warnings
@@ -772,6 +992,28 @@ OUI_EXPORT int uiGetLastItemCount();
 
 #define UI_MAX_KIND 16
 
+// size of a slab of persistent blocks
+#define UI_PERSISTENT_SLAB_SIZE 16384
+// persistent blocks come in sizes of 16<<class bytes
+#define UI_PERSISTENT_CLASSES 9
+// number of hash buckets for interned strings
+#define UI_INTERN_BUCKETS 256
+
+// capacities of the context in static storage used with OUI_STATIC_CONTEXT
+#ifndef OUI_STATIC_ITEM_CAPACITY
+#define OUI_STATIC_ITEM_CAPACITY 4096
+#endif
+#ifndef OUI_STATIC_BUFFER_CAPACITY
+#define OUI_STATIC_BUFFER_CAPACITY (1<<20)
+#endif
+#ifndef OUI_STATIC_CONTEXT_FLAGS
+#define OUI_STATIC_CONTEXT_FLAGS 0
+#endif
+
+// the header in front of each handle stores the size in the lower bits and
+// the log2 of the alignment in the upper bits
+#define UI_HANDLE_SIZE_BITS 27
+
 #define UI_ANY_BUTTON0_INPUT (UI_BUTTON0_DOWN \
         |UI_BUTTON0_UP \
         |UI_BUTTON0_HOT_UP \
@@ -821,8 +1063,10 @@ enum {
 };
 
 typedef struct UIitem {
+#ifndef OUI_COMPACT_ITEMS
     // data handle
     void *handle;
+#endif
 
     // about 27 bits worth of flags
     unsigned int flags;
@@ -856,6 +1100,80 @@ typedef struct UIhandleEntry {
     int item;
 } UIhandleEntry;
 
+typedef struct UIpersistentBlock {
+    // neighbours in the list of live blocks; next also links free blocks
+    struct UIpersistentBlock *prev;
+    struct UIpersistentBlock *next;
+    // item the block belongs to, or -1
+    int item;
+    // number of frames the block has had no item
+    short age;
+    short sclass;
+    // followed by the contents
+} UIpersistentBlock;
+
+// separately allocated memory for large handles
+typedef struct UIchunk {
+    struct UIchunk *next;
+    // bytes following the chunk
+    size_t capacity;
+} UIchunk;
+
+// a child of a wrapping container as uiArrangeWrapped() found it, and where
+// it was placed
+typedef struct UIwrapKid {
+    // start margin, size and end margin in the direction of the container
+    short extent[3];
+    // fill, fixed and break flags in that direction
+    unsigned int flags;
+    // position and size after layout
+    short pos;
+    short size;
+} UIwrapKid;
+
+// a line of a wrapping container
+typedef struct UIwrapLine {
+    // number of children, and of children that fill the line
+    int total;
+    int count;
+    // space used by the children
+    short used;
+    // largest space used up to a child after the first; the line keeps
+    // these children while this fits
+    short max_extend;
+    // space used up to the first child of the next line; the line ends
+    // there while this doesn't fit, unless the break is manual
+    short break_extend;
+    bool hardbreak;
+} UIwrapLine;
+
+// children and lines of a wrapping container
+typedef struct UIwrapContainer {
+    int item;
+    unsigned int flags;
+    // position and size in the direction of the container
+    short start;
+    short space;
+    // ranges in the kids and lines of UIwrapFrame
+    int kids;
+    int kid_count;
+    int lines;
+    int line_count;
+} UIwrapContainer;
+
+// all wrapping containers laid out in a frame, in order of layout; every
+// item is laid out once and is the child of one container, and every line
+// holds at least one child, so each array holds at most item_capacity
+// entries
+typedef struct UIwrapFrame {
+    UIwrapContainer *containers;
+    UIwrapKid *kids;
+    UIwrapLine *lines;
+    int container_count;
+    int kid_count;
+    int line_count;
+} UIwrapFrame;
+
 typedef struct UIinputEvent {
     unsigned int key;
     unsigned int mod;
@@ -865,9 +1183,12 @@ typedef struct UIinputEvent {
 struct UIcontext {
     unsigned int item_capacity;
     unsigned int buffer_capacity;
+    // UIcontextFlags the context was created with
+    unsigned int flags;
 
     // handler
     UIhandler handler;
+    UImeasureHandler measure_handler;
 
     // button state in this frame
     unsigned long long buttons;
@@ -891,6 +1212,8 @@ struct UIcontext {
 
     UIstate state;
     UIstage stage;
+    // see uiNeedsRedraw()
+    int redraw;
     unsigned int active_key;
     unsigned int active_modifier;
     unsigned int active_button_modifier;
@@ -898,16 +1221,63 @@ struct UIcontext {
     int last_click_timestamp;
     int clicks;
 
+    // hot, active and focused item at the end of the last uiEndLayout()
+    int drawn_hot_item;
+    int drawn_active_item;
+    int drawn_focus_item;
+
     int count;    
     int last_count;
     int eventcount;
     unsigned int datasize;
+    int dirty_count;
+    // see uiSetDamageTracking()
+    bool damage_tracking;
+    // true if the handles of this and the last frame have a size header;
+    // decided by uiClear() for each frame
+    bool handle_headers;
+    bool last_handle_headers;
+    // number of items passed to uiInvalidatePlaceholder()
+    int invalid_count;
 
     UIitem *items;
     unsigned char *data;
     UIitem *last_items;
+    // items of the last frame as they were declared, before layout; only
+    // kept with UI_CONTEXT_REUSE
+    UIitem *decl_items;
+    unsigned char *last_data;
     int *item_map;
+    // maps new item ids to unchanged old items, only used in uiEndLayout()
+    int *reverse_map;
+    // persistent block of each item
+    UIpersistentBlock **persistent_map;
+    UIpersistentBlock *persistent_blocks;
+    UIpersistentBlock *persistent_free[UI_PERSISTENT_CLASSES];
+    // interned strings by hash
+    UIpersistentBlock *intern_buckets[UI_INTERN_BUCKETS];
+    // slabs are chained through their first pointer
+    void *persistent_slabs;
+    // chunks of this and the last frame, and chunks for reuse
+    UIchunk *chunks;
+    UIchunk *last_chunks;
+    UIchunk *spare_chunks;
+    // wrapping containers of this and the last frame; lines of the last
+    // frame are kept where their children and space haven't changed
+    UIwrapFrame wrap_frame;
+    UIwrapFrame last_wrap_frame;
+    // next container of the last frame to be matched by uiArrangeWrapped()
+    int wrap_cursor;
+    // block holding the context if allocated by uiCreateContext()
+    void *memory;
+#ifdef OUI_COMPACT_ITEMS
+    // item handles, kept apart from the items
+    void **handles;
+    void **last_handles;
+#endif
     UIinputEvent events[UI_MAX_INPUT_EVENTS];
+    UIrect dirty_rects[UI_MAX_DIRTY_RECTS];
+    int invalid_items[UI_MAX_INVALID_PLACEHOLDERS];
 };
 
 UI_INLINE int ui_max(int a, int b) {
@@ -937,25 +1307,124 @@ void uiClear() {
     UIitem *items = ui_context->items;
     ui_context->items = ui_context->last_items;
     ui_context->last_items = items;
+    unsigned char *data = ui_context->data;
+    ui_context->data = ui_context->last_data;
+    ui_context->last_data = data;
+#ifdef OUI_COMPACT_ITEMS
+    void **handles = ui_context->handles;
+    ui_context->handles = ui_context->last_handles;
+    ui_context->last_handles = handles;
+#endif
+    // recycle the chunks of the frame before the last
+    UIchunk **spare = &ui_context->spare_chunks;
+    while (*spare)
+        spare = &(*spare)->next;
+    *spare = ui_context->last_chunks;
+    ui_context->last_chunks = ui_context->chunks;
+    ui_context->chunks = NULL;
+    UIwrapFrame wrap_frame = ui_context->wrap_frame;
+    ui_context->wrap_frame = ui_context->last_wrap_frame;
+    ui_context->last_wrap_frame = wrap_frame;
+    ui_context->wrap_frame.container_count = 0;
+    ui_context->wrap_frame.kid_count = 0;
+    ui_context->wrap_frame.line_count = 0;
+    ui_context->wrap_cursor = 0;
+    ui_context->last_handle_headers = ui_context->handle_headers;
+    ui_context->handle_headers = ui_context->damage_tracking
+        || (ui_context->flags & UI_CONTEXT_REUSE);
     for (int i = 0; i < ui_context->last_count; ++i) {
         ui_context->item_map[i] = -1;
     }
 }
 
-UIcontext *uiCreateContext(
+// all arrays of a context are carved from one block of memory
+#define UI_ALIGN_SIZE(SIZE) (((SIZE) + 7) & ~(size_t)7)
+#ifdef OUI_COMPACT_ITEMS
+#define UI_HANDLES_FOOTPRINT(ITEMS) (2*UI_ALIGN_SIZE(sizeof(void *) * (ITEMS)))
+#else
+#define UI_HANDLES_FOOTPRINT(ITEMS) 0
+#endif
+#define UI_WRAP_FRAME_FOOTPRINT(ITEMS) \
+    (UI_ALIGN_SIZE(sizeof(UIwrapContainer) * (ITEMS)) \
+    + UI_ALIGN_SIZE(sizeof(UIwrapKid) * (ITEMS)) \
+    + UI_ALIGN_SIZE(sizeof(UIwrapLine) * (ITEMS)))
+#define UI_CONTEXT_FOOTPRINT(ITEMS, BUFFER, FLAGS) \
+    (UI_ALIGN_SIZE(sizeof(UIcontext)) \
+    + 2*UI_ALIGN_SIZE(sizeof(UIitem) * (ITEMS)) \
+    + (((FLAGS) & UI_CONTEXT_REUSE)?UI_ALIGN_SIZE(sizeof(UIitem) * (ITEMS)):0) \
+    + 2*UI_ALIGN_SIZE(sizeof(int) * (ITEMS)) \
+    + UI_ALIGN_SIZE(sizeof(UIpersistentBlock *) * (ITEMS)) \
+    + UI_HANDLES_FOOTPRINT(ITEMS) \
+    + 2*UI_WRAP_FRAME_FOOTPRINT(ITEMS) \
+    + 2*UI_ALIGN_SIZE(BUFFER))
+
+#ifdef OUI_STATIC_CONTEXT
+static union {
+    UIcontext ctx;
+    unsigned char bytes[UI_CONTEXT_FOOTPRINT(OUI_STATIC_ITEM_CAPACITY,
+        OUI_STATIC_BUFFER_CAPACITY, OUI_STATIC_CONTEXT_FLAGS)];
+} ui_static_storage;
+static bool ui_static_storage_used = false;
+#endif
+
+unsigned int uiContextFootprint(
         unsigned int item_capacity,
-        unsigned int buffer_capacity) {
+        unsigned int buffer_capacity,
+        unsigned int flags) {
+    return (unsigned int)UI_CONTEXT_FOOTPRINT(item_capacity, buffer_capacity,
+        flags);
+}
+
+UIcontext *uiCreateContextInPlace(
+        void *memory, unsigned int size,
+        unsigned int item_capacity,
+        unsigned int buffer_capacity,
+        unsigned int flags) {
     assert(item_capacity);
-    UIcontext *ctx = (UIcontext *)malloc(sizeof(UIcontext));
+    assert(memory && !((uintptr_t)memory & 7));
+    assert(size >= uiContextFootprint(item_capacity, buffer_capacity, flags));
+    unsigned char *ptr = (unsigned char *)memory;
+    UIcontext *ctx = (UIcontext *)ptr;
+    ptr += UI_ALIGN_SIZE(sizeof(UIcontext));
     memset(ctx, 0, sizeof(UIcontext));
     ctx->item_capacity = item_capacity;
     ctx->buffer_capacity = buffer_capacity;
+    ctx->flags = flags;
     ctx->stage = UI_STAGE_PROCESS;
-    ctx->items = (UIitem *)malloc(sizeof(UIitem) * item_capacity);
-    ctx->last_items = (UIitem *)malloc(sizeof(UIitem) * item_capacity);
-    ctx->item_map = (int *)malloc(sizeof(int) * item_capacity);
+    ctx->items = (UIitem *)ptr;
+    ptr += UI_ALIGN_SIZE(sizeof(UIitem) * item_capacity);
+    ctx->last_items = (UIitem *)ptr;
+    ptr += UI_ALIGN_SIZE(sizeof(UIitem) * item_capacity);
+    if (flags & UI_CONTEXT_REUSE) {
+        ctx->decl_items = (UIitem *)ptr;
+        ptr += UI_ALIGN_SIZE(sizeof(UIitem) * item_capacity);
+    }
+    ctx->item_map = (int *)ptr;
+    ptr += UI_ALIGN_SIZE(sizeof(int) * item_capacity);
+    ctx->reverse_map = (int *)ptr;
+    ptr += UI_ALIGN_SIZE(sizeof(int) * item_capacity);
+    ctx->persistent_map = (UIpersistentBlock **)ptr;
+    memset(ctx->persistent_map, 0, sizeof(UIpersistentBlock *) * item_capacity);
+    ptr += UI_ALIGN_SIZE(sizeof(UIpersistentBlock *) * item_capacity);
+#ifdef OUI_COMPACT_ITEMS
+    ctx->handles = (void **)ptr;
+    ptr += UI_ALIGN_SIZE(sizeof(void *) * item_capacity);
+    ctx->last_handles = (void **)ptr;
+    ptr += UI_ALIGN_SIZE(sizeof(void *) * item_capacity);
+#endif
+    UIwrapFrame *wrap_frames[2] = { &ctx->wrap_frame, &ctx->last_wrap_frame };
+    for (int i = 0; i < 2; ++i) {
+        wrap_frames[i]->containers = (UIwrapContainer *)ptr;
+        ptr += UI_ALIGN_SIZE(sizeof(UIwrapContainer) * item_capacity);
+        wrap_frames[i]->kids = (UIwrapKid *)ptr;
+        ptr += UI_ALIGN_SIZE(sizeof(UIwrapKid) * item_capacity);
+        wrap_frames[i]->lines = (UIwrapLine *)ptr;
+        ptr += UI_ALIGN_SIZE(sizeof(UIwrapLine) * item_capacity);
+    }
     if (buffer_capacity) {
-        ctx->data = (unsigned char *)malloc(buffer_capacity);
+        ctx->data = ptr;
+        ptr += UI_ALIGN_SIZE(buffer_capacity);
+        ctx->last_data = ptr;
     }
 
     UIcontext *oldctx = ui_context;
@@ -966,6 +1435,36 @@ UIcontext *uiCreateContext(
     return ctx;
 }
 
+UIcontext *uiCreateContextEx(
+        unsigned int item_capacity,
+        unsigned int buffer_capacity,
+        unsigned int flags) {
+#ifdef OUI_STATIC_CONTEXT
+    assert(!ui_static_storage_used);
+    assert(item_capacity <= OUI_STATIC_ITEM_CAPACITY);
+    assert(buffer_capacity <= OUI_STATIC_BUFFER_CAPACITY);
+    assert(!(flags & ~(unsigned int)OUI_STATIC_CONTEXT_FLAGS));
+    ui_static_storage_used = true;
+    return uiCreateContextInPlace(&ui_static_storage,
+        sizeof(ui_static_storage), item_capacity, buffer_capacity, flags);
+#else
+    unsigned int size = uiContextFootprint(item_capacity, buffer_capacity,
+        flags);
+    void *memory = malloc(size);
+    assert(memory);
+    UIcontext *ctx = uiCreateContextInPlace(memory, size,
+        item_capacity, buffer_capacity, flags);
+    ctx->memory = memory;
+    return ctx;
+#endif
+}
+
+UIcontext *uiCreateContext(
+        unsigned int item_capacity,
+        unsigned int buffer_capacity) {
+    return uiCreateContextEx(item_capacity, buffer_capacity, 0);
+}
+
 void uiMakeCurrent(UIcontext *ctx) {
     ui_context = ctx;
 }
@@ -973,11 +1472,25 @@ void uiMakeCurrent(UIcontext *ctx) {
 void uiDestroyContext(UIcontext *ctx) {
     if (ui_context == ctx)
         uiMakeCurrent(NULL);
-    free(ctx->items);
-    free(ctx->last_items);
-    free(ctx->item_map);
-    free(ctx->data);
-    free(ctx);
+    UIchunk *lists[3] = { ctx->chunks, ctx->last_chunks, ctx->spare_chunks };
+    for (int i = 0; i < 3; ++i) {
+        while (lists[i]) {
+            UIchunk *chunk = lists[i];
+            lists[i] = chunk->next;
+            free(chunk);
+        }
+    }
+    while (ctx->persistent_slabs) {
+        void *slab = ctx->persistent_slabs;
+        ctx->persistent_slabs = *(void **)slab;
+        free(slab);
+    }
+#ifdef OUI_STATIC_CONTEXT
+    if (ctx == &ui_static_storage.ctx)
+        ui_static_storage_used = false;
+#endif
+    // the context itself lives in this block
+    free(ctx->memory);
 }
 
 OUI_EXPORT UIcontext *uiGetContext() {
@@ -987,17 +1500,21 @@ OUI_EXPORT UIcontext *uiGetContext() {
 void uiSetButton(unsigned int button, unsigned int mod, int enabled) {
     assert(ui_context);
     unsigned long long mask = 1ull<<button;
+    unsigned long long buttons = ui_context->buttons;
     // set new bit
     ui_context->buttons = (enabled)?
             (ui_context->buttons | mask):
             (ui_context->buttons & ~mask);
     ui_context->active_button_modifier = mod;
+    if (ui_context->buttons != buttons)
+        ui_context->redraw = 1;
 }
 
 static void uiAddInputEvent(UIinputEvent event) {
     assert(ui_context);
     if (ui_context->eventcount == UI_MAX_INPUT_EVENTS) return;
     ui_context->events[ui_context->eventcount++] = event;
+    ui_context->redraw = 1;
 }
 
 static void uiClearInputEvents() {
@@ -1023,6 +1540,8 @@ void uiSetScroll(int x, int y) {
     assert(ui_context);
     ui_context->scroll.x += x;
     ui_context->scroll.y += y;
+    if (x || y)
+        ui_context->redraw = 1;
 }
 
 UIvec2 uiGetScroll() {
@@ -1052,6 +1571,8 @@ int uiButtonReleased(int button) {
 
 void uiSetCursor(int x, int y) {
     assert(ui_context);
+    if ((ui_context->cursor.x != x) || (ui_context->cursor.y != y))
+        ui_context->redraw = 1;
     ui_context->cursor.x = x;
     ui_context->cursor.y = y;
 }
@@ -1119,6 +1640,24 @@ UIitem *uiLastItemPtr(int item) {
     return ui_context->last_items + item;
 }
 
+UI_INLINE void **uiHandlePtr(int item) {
+#ifdef OUI_COMPACT_ITEMS
+    assert(ui_context && (item >= 0) && (item < ui_context->count));
+    return ui_context->handles + item;
+#else
+    return &uiItemPtr(item)->handle;
+#endif
+}
+
+UI_INLINE void **uiLastHandlePtr(int item) {
+#ifdef OUI_COMPACT_ITEMS
+    assert(ui_context && (item >= 0) && (item < ui_context->last_count));
+    return ui_context->last_handles + item;
+#else
+    return &uiLastItemPtr(item)->handle;
+#endif
+}
+
 int uiGetHotItem() {
     assert(ui_context);
     return ui_context->hot_item;
@@ -1166,6 +1705,7 @@ int uiItem() {
     int idx = ui_context->count++;
     UIitem *item = uiItemPtr(idx);
     memset(item, 0, sizeof(UIitem));
+    *uiHandlePtr(idx) = NULL;
     item->firstkid = -1;
     item->nextitem = -1;
     return idx;
@@ -1178,6 +1718,11 @@ void uiNotifyItem(int item, UIevent event) {
     assert((event & UI_ITEM_EVENT_MASK) == event);
     UIitem *pitem = uiItemPtr(item);
     if (pitem->flags & event) {
+        // holding the button still is not a change
+        if ((event != UI_BUTTON0_CAPTURE)
+            || (ui_context->cursor.x != ui_context->last_cursor.x)
+            || (ui_context->cursor.y != ui_context->last_cursor.y))
+            ui_context->redraw = 1;
         ui_context->handler(item, event);
     }
 }
@@ -1387,18 +1932,110 @@ UI_INLINE void uiComputeWrappedSize(UIitem *pitem, int dim) {
     pitem->size[dim] = need_size2 + need_size;
 }
 
-static void uiComputeSize(int item, int dim) {
+// compute the width of each column of a grid, and whether it can grow;
+// returns the number of columns. a cell past UI_MAX_GRID_COLUMNS starts a
+// new row, and is marked with UI_BREAK for the row pass.
+UI_INLINE int uiComputeGridColumns(UIitem *pitem, short *widths, bool *grow) {
+    int count = 0;
+    int column = 0;
+    int kid = pitem->firstkid;
+    while (kid >= 0) {
+        UIitem *pkid = uiItemPtr(kid);
+
+        if (column == UI_MAX_GRID_COLUMNS) {
+            // add marker for subsequent queries
+            pkid->flags |= UI_BREAK;
+        }
+        if ((pkid->flags & UI_BREAK) && (kid != pitem->firstkid)) {
+            // new row
+            column = 0;
+        }
+        if (column == count) {
+            widths[column] = 0;
+            grow[column] = false;
+            count++;
+        }
+
+        // width = start margin + calculated width + end margin
+        int kidsize = pkid->margins[0] + pkid->size[0] + pkid->margins[2];
+        widths[column] = ui_max(widths[column], kidsize);
+        if ((pkid->flags & UI_HFILL) == UI_HFILL)
+            grow[column] = true;
+        column++;
+        kid = uiNextSibling(kid);
+    }
+    return count;
+}
+
+// compute bounding box of all items in a grid
+UI_INLINE void uiComputeGridSize(UIitem *pitem, int dim) {
+    short need_size = 0;
+    if (!dim) {
+        // sum of column widths
+        short widths[UI_MAX_GRID_COLUMNS];
+        bool grow[UI_MAX_GRID_COLUMNS];
+        int count = uiComputeGridColumns(pitem, widths, grow);
+        for (int i = 0; i < count; ++i)
+            need_size += widths[i];
+    } else {
+        // sum of row heights
+        short row_size = 0;
+        int kid = pitem->firstkid;
+        while (kid >= 0) {
+            UIitem *pkid = uiItemPtr(kid);
+
+            if ((pkid->flags & UI_BREAK) && (kid != pitem->firstkid)) {
+                need_size += row_size;
+                // new row
+                row_size = 0;
+            }
+
+            // height = start margin + calculated height + end margin
+            int kidsize = pkid->margins[1] + pkid->size[1] + pkid->margins[3];
+            row_size = ui_max(row_size, kidsize);
+            kid = uiNextSibling(kid);
+        }
+        need_size += row_size;
+    }
+    pitem->size[dim] = need_size;
+}
+
+// returns true if the box model of the item arranges children that fill it
+// in dimension dim without reading their own size; wrapped lines and grid
+// cells are as large as their largest child, filling or not
+UI_INLINE bool uiIgnoresFillerSize(UIitem *pitem, int dim) {
+    switch(pitem->flags & UI_ITEM_BOX_MODEL_MASK) {
+    case UI_COLUMN|UI_WRAP: return (dim == 1);
+    case UI_ROW|UI_WRAP: return (dim == 0);
+    case UI_GRID:
+    case UI_GRID|UI_WRAP: return false;
+    default: return true;
+    }
+}
+
+static void uiComputeSize(int item, int dim, bool filler_ignored) {
     UIitem *pitem = uiItemPtr(item);
+    // a fixed parent may not need the size of children that fill it
+    bool ignore = (pitem->size[dim] != 0) && uiIgnoresFillerSize(pitem, dim);
 
     // children expand the size
     int kid = pitem->firstkid;
     while (kid >= 0) {
-        uiComputeSize(kid, dim);
+        uiComputeSize(kid, dim, ignore);
         kid = uiNextSibling(kid);
     }
 
     if (pitem->size[dim])
         return;
+    if ((pitem->firstkid < 0) && ui_context->measure_handler) {
+        // the contents of items filling a fixed parent that ignores them
+        // don't matter
+        int flags = (pitem->flags & UI_ITEM_LAYOUT_MASK) >> dim;
+        if (!filler_ignored || ((flags & UI_HFILL) != UI_HFILL)) {
+            pitem->size[dim] = (short)ui_context->measure_handler(item, dim);
+        }
+        return;
+    }
     switch(pitem->flags & UI_ITEM_BOX_MODEL_MASK) {
     case UI_COLUMN|UI_WRAP: {
         // flex model
@@ -1422,6 +2059,11 @@ static void uiComputeSize(int item, int dim) {
         else
             uiComputeImposedSize(pitem, dim);
     } break;
+    case UI_GRID:
+    case UI_GRID|UI_WRAP: {
+        // grid model
+        uiComputeGridSize(pitem, dim);
+    } break;
     default: {
         // layout model
         uiComputeImposedSize(pitem, dim);
@@ -1430,70 +2072,274 @@ static void uiComputeSize(int item, int dim) {
 }
 
 // stack all items according to their alignment
-UI_INLINE void uiArrangeStacked(UIitem *pitem, int dim, bool wrap) {
+UI_INLINE void uiArrangeStacked(UIitem *pitem, int dim) {
     int wdim = dim+2;
 
     short space = pitem->size[dim];
-    float max_x2 = (float)pitem->margins[dim] + (float)space;
-
-    int start_kid = pitem->firstkid;
-    while (start_kid >= 0) {
-        short used = 0;
-
-        int count = 0; // count of fillers
-        int squeezed_count = 0; // count of squeezable elements
-        int total = 0;
-        bool hardbreak = false;
-        // first pass: count items that need to be expanded,
-        // and the space that is used
-        int kid = start_kid;
-        int end_kid = -1;
-        while (kid >= 0) {
-            UIitem *pkid = uiItemPtr(kid);
-            int flags = (pkid->flags & UI_ITEM_LAYOUT_MASK) >> dim;
-            int fflags = (pkid->flags & UI_ITEM_FIXED_MASK) >> dim;
-            short extend = used;
-            if ((flags & UI_HFILL) == UI_HFILL) { // grow
-                count++;
-                extend += pkid->margins[dim] + pkid->margins[wdim];
+    short used = 0;
+
+    int count = 0; // count of fillers
+    int squeezed_count = 0; // count of squeezable elements
+    int total = 0;
+    // first pass: count items that need to be expanded,
+    // and the space that is used
+    int kid = pitem->firstkid;
+    while (kid >= 0) {
+        UIitem *pkid = uiItemPtr(kid);
+        int flags = (pkid->flags & UI_ITEM_LAYOUT_MASK) >> dim;
+        int fflags = (pkid->flags & UI_ITEM_FIXED_MASK) >> dim;
+        if ((flags & UI_HFILL) == UI_HFILL) { // grow
+            count++;
+            used += pkid->margins[dim] + pkid->margins[wdim];
+        } else {
+            if ((fflags & UI_ITEM_HFIXED) != UI_ITEM_HFIXED)
+                squeezed_count++;
+            used += pkid->margins[dim] + pkid->size[dim] + pkid->margins[wdim];
+        }
+        kid = uiNextSibling(kid);
+        total++;
+    }
+
+    int extra_space = space - used;
+    float filler = 0.0f;
+    float spacer = 0.0f;
+    float extra_margin = 0.0f;
+    float eater = 0.0f;
+
+    if (extra_space > 0) {
+        if (count) {
+            filler = (float)extra_space / (float)count;
+        } else if (total) {
+            switch(pitem->flags & UI_JUSTIFY) {
+            default: {
+                extra_margin = extra_space / 2.0f;
+            } break;
+            case UI_JUSTIFY: {
+                spacer = (float)extra_space / (float)(total-1);
+            } break;
+            case UI_START: {
+            } break;
+            case UI_END: {
+                extra_margin = extra_space;
+            } break;
+            }
+        }
+    } else if (extra_space < 0) {
+       eater = (float)extra_space / (float)squeezed_count;
+    }
+
+    // distribute width among items
+    float x = (float)pitem->margins[dim];
+    float x1;
+    // second pass: distribute and rescale
+    kid = pitem->firstkid;
+    while (kid >= 0) {
+        short ix0,ix1;
+        UIitem *pkid = uiItemPtr(kid);
+        int flags = (pkid->flags & UI_ITEM_LAYOUT_MASK) >> dim;
+        int fflags = (pkid->flags & UI_ITEM_FIXED_MASK) >> dim;
+
+        x += (float)pkid->margins[dim] + extra_margin;
+        if ((flags & UI_HFILL) == UI_HFILL) { // grow
+            x1 = x+filler;
+        } else if ((fflags & UI_ITEM_HFIXED) == UI_ITEM_HFIXED) {
+            x1 = x+(float)pkid->size[dim];
+        } else {
+            // squeeze
+            x1 = x+ui_maxf(0.0f,(float)pkid->size[dim]+eater);
+        }
+        ix0 = (short)x;
+        ix1 = (short)x1;
+        pkid->margins[dim] = ix0;
+        pkid->size[dim] = ix1-ix0;
+        x = x1 + (float)pkid->margins[wdim];
+
+        kid = uiNextSibling(kid);
+        extra_margin = spacer;
+    }
+}
+
+// returns the container of the last frame laid out in the same order, if it
+// is the same item with the same box flags
+static const UIwrapContainer *uiFindWrapContainer(int item, unsigned int flags) {
+    const UIwrapFrame *last = &ui_context->last_wrap_frame;
+    if (ui_context->wrap_cursor >= last->container_count)
+        return NULL;
+    const UIwrapContainer *old = last->containers + ui_context->wrap_cursor;
+    if ((old->item != item) || (old->flags != flags))
+        return NULL;
+    ui_context->wrap_cursor++;
+    return old;
+}
+
+// find the lines of a wrapping container from its child start on
+UI_INLINE void uiFindWrapLines(UIwrapFrame *frame, UIwrapContainer *container,
+        int start) {
+    const UIwrapKid *kids = frame->kids + container->kids;
+    short space = container->space;
+    while (start < container->kid_count) {
+        UIwrapLine line;
+        line.total = 0;
+        line.count = 0;
+        line.used = 0;
+        line.max_extend = -32768;
+        line.break_extend = 0;
+        line.hardbreak = false;
+        int k = start;
+        while (k < container->kid_count) {
+            const UIwrapKid *wkid = kids + k;
+            short extend = line.used;
+            if ((wkid->flags & UI_HFILL) == UI_HFILL) { // grow
+                line.count++;
+                extend += wkid->extent[0] + wkid->extent[2];
             } else {
-                if ((fflags & UI_ITEM_HFIXED) != UI_ITEM_HFIXED)
-                    squeezed_count++;
-                extend += pkid->margins[dim] + pkid->size[dim] + pkid->margins[wdim];
+                extend += wkid->extent[0] + wkid->extent[1] + wkid->extent[2];
             }
             // wrap on end of line or manual flag
-            if (wrap && (total && ((extend > space) || (pkid->flags & UI_BREAK)))) {
-                end_kid = kid;
-                hardbreak = ((pkid->flags & UI_BREAK) == UI_BREAK);
-                // add marker for subsequent queries
-                pkid->flags |= UI_BREAK;
+            if (line.total && ((extend > space) || (wkid->flags & UI_BREAK))) {
+                line.break_extend = extend;
+                line.hardbreak = ((wkid->flags & UI_BREAK) == UI_BREAK);
                 break;
+            }
+            if (line.total)
+                line.max_extend = ui_max(line.max_extend, extend);
+            line.used = extend;
+            line.total++;
+            k++;
+        }
+        frame->lines[frame->line_count++] = line;
+        container->line_count++;
+        start = k;
+    }
+}
+
+// stack all items according to their alignment, breaking lines where they
+// run out of space. the children and lines are kept for the next frame;
+// lines whose children haven't changed are kept as long as their breaks
+// don't move with the space of the container, and if the container didn't
+// move either, their children are placed where they were.
+static void uiArrangeWrapped(int item, int dim) {
+    UIitem *pitem = uiItemPtr(item);
+    int wdim = dim+2;
+
+    UIwrapFrame *frame = &ui_context->wrap_frame;
+    const UIwrapFrame *last = &ui_context->last_wrap_frame;
+    const UIwrapContainer *old = uiFindWrapContainer(item,
+        pitem->flags & UI_ITEM_BOX_MASK);
+    UIwrapContainer *container = frame->containers + frame->container_count++;
+    container->item = item;
+    container->flags = pitem->flags & UI_ITEM_BOX_MASK;
+    container->start = pitem->margins[dim];
+    container->space = pitem->size[dim];
+    container->kids = frame->kid_count;
+    container->kid_count = 0;
+    container->lines = frame->line_count;
+    container->line_count = 0;
+
+    // record the children, and how many of them are unchanged
+    const UIwrapKid *oldkids = old?(last->kids + old->kids):NULL;
+    int unchanged = -1;
+    int kid = pitem->firstkid;
+    while (kid >= 0) {
+        UIitem *pkid = uiItemPtr(kid);
+        UIwrapKid *wkid = frame->kids + frame->kid_count++;
+        wkid->extent[0] = pkid->margins[dim];
+        wkid->extent[1] = pkid->size[dim];
+        wkid->extent[2] = pkid->margins[wdim];
+        wkid->flags = (((pkid->flags & UI_ITEM_LAYOUT_MASK) >> dim) & UI_HFILL)
+            | (((pkid->flags & UI_ITEM_FIXED_MASK) >> dim) & UI_ITEM_HFIXED)
+            | (pkid->flags & UI_BREAK);
+        if ((unchanged < 0) && (!old
+            || (container->kid_count >= old->kid_count)
+            || memcmp(wkid->extent, oldkids[container->kid_count].extent,
+                sizeof(wkid->extent))
+            || (wkid->flags != oldkids[container->kid_count].flags))) {
+            unchanged = container->kid_count;
+        }
+        container->kid_count++;
+        kid = uiNextSibling(kid);
+    }
+    if (unchanged < 0)
+        unchanged = container->kid_count;
+
+    // keep the lines of the last frame up to the first that changes
+    int start = 0;
+    if (old) {
+        const UIwrapLine *oldlines = last->lines + old->lines;
+        for (int i = 0; i < old->line_count; ++i) {
+            const UIwrapLine *line = oldlines + i;
+            int end = start + line->total;
+            if (end == old->kid_count) {
+                // the last line ends with the children
+                if ((unchanged != container->kid_count)
+                    || (container->kid_count != old->kid_count))
+                    break;
             } else {
-                used = extend;
+                // the first child of the next line decides the break
+                if ((end >= unchanged)
+                    || (!line->hardbreak
+                        && (line->break_extend <= container->space)))
+                    break;
+            }
+            if (line->max_extend > container->space) break;
+            frame->lines[frame->line_count++] = *line;
+            container->line_count++;
+            start = end;
+        }
+    }
+    int kept = container->line_count;
+    uiFindWrapLines(frame, container, start);
+
+    // kept lines are placed like in the last frame if the container is
+    // where it was
+    if (!old || (old->start != container->start)
+        || (old->space != container->space))
+        kept = 0;
+
+    UIwrapKid *wkids = frame->kids + container->kids;
+    short space = container->space;
+    float max_x2 = (float)container->start + (float)space;
+    int k = 0;
+    kid = pitem->firstkid;
+    for (int i = 0; i < container->line_count; ++i) {
+        const UIwrapLine *line = frame->lines + container->lines + i;
+        int end = k + line->total;
+
+        if (i) {
+            // add marker for subsequent queries
+            uiItemPtr(kid)->flags |= UI_BREAK;
+        }
+
+        if (i < kept) {
+            for (; k < end; ++k) {
+                UIitem *pkid = uiItemPtr(kid);
+                wkids[k].pos = oldkids[k].pos;
+                wkids[k].size = oldkids[k].size;
+                pkid->margins[dim] = wkids[k].pos;
+                pkid->size[dim] = wkids[k].size;
                 kid = uiNextSibling(kid);
             }
-            total++;
+            continue;
         }
 
-        int extra_space = space - used;
+        int extra_space = space - line->used;
         float filler = 0.0f;
         float spacer = 0.0f;
         float extra_margin = 0.0f;
-        float eater = 0.0f;
 
         if (extra_space > 0) {
-            if (count) {
-                filler = (float)extra_space / (float)count;
-            } else if (total) {
+            if (line->count) {
+                filler = (float)extra_space / (float)line->count;
+            } else if (line->total) {
                 switch(pitem->flags & UI_JUSTIFY) {
                 default: {
                     extra_margin = extra_space / 2.0f;
                 } break;
                 case UI_JUSTIFY: {
-                    // justify when not wrapping or not in last line,
+                    // justify when not in last line,
                     // or not manually breaking
-                    if (!wrap || ((end_kid != -1) && !hardbreak))
-                        spacer = (float)extra_space / (float)(total-1);
+                    if ((end != container->kid_count) && !line->hardbreak)
+                        spacer = (float)extra_space / (float)(line->total-1);
                 } break;
                 case UI_START: {
                 } break;
@@ -1502,44 +2348,36 @@ UI_INLINE void uiArrangeStacked(UIitem *pitem, int dim, bool wrap) {
                 } break;
                 }
             }
-        } else if (!wrap && (extra_space < 0)) {
-           eater = (float)extra_space / (float)squeezed_count;
         }
 
         // distribute width among items
-        float x = (float)pitem->margins[dim];
+        float x = (float)container->start;
         float x1;
-        // second pass: distribute and rescale
-        kid = start_kid;
-        while (kid != end_kid) {
+        for (; k < end; ++k) {
             short ix0,ix1;
             UIitem *pkid = uiItemPtr(kid);
-            int flags = (pkid->flags & UI_ITEM_LAYOUT_MASK) >> dim;
-            int fflags = (pkid->flags & UI_ITEM_FIXED_MASK) >> dim;
+            const UIwrapKid *wkid = wkids + k;
 
-            x += (float)pkid->margins[dim] + extra_margin;
-            if ((flags & UI_HFILL) == UI_HFILL) { // grow
+            x += (float)wkid->extent[0] + extra_margin;
+            if ((wkid->flags & UI_HFILL) == UI_HFILL) { // grow
                 x1 = x+filler;
-            } else if ((fflags & UI_ITEM_HFIXED) == UI_ITEM_HFIXED) {
-                x1 = x+(float)pkid->size[dim];
+            } else if ((wkid->flags & UI_ITEM_HFIXED) == UI_ITEM_HFIXED) {
+                x1 = x+(float)wkid->extent[1];
             } else {
                 // squeeze
-                x1 = x+ui_maxf(0.0f,(float)pkid->size[dim]+eater);
+                x1 = x+ui_maxf(0.0f,(float)wkid->extent[1]);
             }
             ix0 = (short)x;
-            if (wrap)
-                ix1 = (short)ui_minf(max_x2-(float)pkid->margins[wdim], x1);
-            else
-                ix1 = (short)x1;
+            ix1 = (short)ui_minf(max_x2-(float)wkid->extent[2], x1);
             pkid->margins[dim] = ix0;
             pkid->size[dim] = ix1-ix0;
-            x = x1 + (float)pkid->margins[wdim];
+            wkids[k].pos = ix0;
+            wkids[k].size = ix1-ix0;
+            x = x1 + (float)wkid->extent[2];
 
             kid = uiNextSibling(kid);
             extra_margin = spacer;
         }
-
-        start_kid = end_kid;
     }
 }
 
@@ -1646,6 +2484,105 @@ UI_INLINE short uiArrangeWrappedImposedSqueezed(UIitem *pitem, int dim) {
     return offset;
 }
 
+// place all items in the columns of a grid
+UI_INLINE void uiArrangeGridColumns(UIitem *pitem) {
+    short widths[UI_MAX_GRID_COLUMNS];
+    bool grow[UI_MAX_GRID_COLUMNS];
+    int count = uiComputeGridColumns(pitem, widths, grow);
+
+    int used = 0;
+    int fillers = 0;
+    for (int i = 0; i < count; ++i) {
+        used += widths[i];
+        if (grow[i])
+            fillers++;
+    }
+    // distribute remaining space among growing columns
+    int extra_space = pitem->size[0] - used;
+    if ((extra_space > 0) && fillers) {
+        int filled = 0;
+        for (int i = 0; i < count; ++i) {
+            if (!grow[i]) continue;
+            widths[i] += extra_space*(filled+1)/fillers - extra_space*filled/fillers;
+            filled++;
+        }
+    }
+
+    short x = pitem->margins[0];
+    int column = 0;
+    int kid = pitem->firstkid;
+    while (kid >= 0) {
+        UIitem *pkid = uiItemPtr(kid);
+        int next = uiNextSibling(kid);
+
+        if ((pkid->flags & UI_BREAK) && (kid != pitem->firstkid)) {
+            // new row
+            column = 0;
+            x = pitem->margins[0];
+        }
+        uiArrangeImposedRange(pitem, 0, kid, next, x, widths[column]);
+        x += widths[column];
+        column++;
+        kid = next;
+    }
+}
+
+// find the end and height of the grid row starting at start_kid, and
+// whether it can grow
+UI_INLINE int uiComputeGridRow(int start_kid, short *height, bool *grow) {
+    short row_size = 0;
+    bool row_grow = false;
+    int kid = start_kid;
+    while (kid >= 0) {
+        UIitem *pkid = uiItemPtr(kid);
+        if ((pkid->flags & UI_BREAK) && (kid != start_kid))
+            break;
+
+        // height = start margin + calculated height + end margin
+        int kidsize = pkid->margins[1] + pkid->size[1] + pkid->margins[3];
+        row_size = ui_max(row_size, kidsize);
+        if ((pkid->flags & UI_VFILL) == UI_VFILL)
+            row_grow = true;
+        kid = uiNextSibling(kid);
+    }
+    *height = row_size;
+    *grow = row_grow;
+    return kid;
+}
+
+// place all items in the rows of a grid
+UI_INLINE void uiArrangeGridRows(UIitem *pitem) {
+    short height;
+    bool grow;
+
+    // first pass: the space that is used, and rows that need to be expanded
+    int used = 0;
+    int fillers = 0;
+    int kid = pitem->firstkid;
+    while (kid >= 0) {
+        kid = uiComputeGridRow(kid, &height, &grow);
+        used += height;
+        if (grow)
+            fillers++;
+    }
+    int extra_space = ui_max(0, pitem->size[1] - used);
+
+    // second pass: distribute remaining space among growing rows
+    short y = pitem->margins[1];
+    int filled = 0;
+    kid = pitem->firstkid;
+    while (kid >= 0) {
+        int end_kid = uiComputeGridRow(kid, &height, &grow);
+        if (grow) {
+            height += extra_space*(filled+1)/fillers - extra_space*filled/fillers;
+            filled++;
+        }
+        uiArrangeImposedRange(pitem, 1, kid, end_kid, y, height);
+        y += height;
+        kid = end_kid;
+    }
+}
+
 static void uiArrange(int item, int dim) {
     UIitem *pitem = uiItemPtr(item);
 
@@ -1653,7 +2590,7 @@ static void uiArrange(int item, int dim) {
     case UI_COLUMN|UI_WRAP: {
         // flex model, wrapping
         if (dim) { // direction
-            uiArrangeStacked(pitem, 1, true);
+            uiArrangeWrapped(item, 1);
             // this retroactive resize will not effect parent widths
             short offset = uiArrangeWrappedImposedSqueezed(pitem, 0);
             pitem->size[0] = offset - pitem->margins[0];
@@ -1662,7 +2599,7 @@ static void uiArrange(int item, int dim) {
     case UI_ROW|UI_WRAP: {
         // flex model, wrapping
         if (!dim) { // direction
-            uiArrangeStacked(pitem, 0, true);
+            uiArrangeWrapped(item, 0);
         } else {
             uiArrangeWrappedImposedSqueezed(pitem, 1);
         }
@@ -1671,10 +2608,18 @@ static void uiArrange(int item, int dim) {
     case UI_ROW: {
         // flex model
         if ((pitem->flags & 1) == (unsigned int)dim) // direction
-            uiArrangeStacked(pitem, dim, false);
+            uiArrangeStacked(pitem, dim);
         else
             uiArrangeImposedSqueezed(pitem, dim);
     } break;
+    case UI_GRID:
+    case UI_GRID|UI_WRAP: {
+        // grid model
+        if (!dim)
+            uiArrangeGridColumns(pitem);
+        else
+            uiArrangeGridRows(pitem);
+    } break;
     default: {
         // layout model
         uiArrangeImposed(pitem, dim);
@@ -1688,6 +2633,22 @@ static void uiArrange(int item, int dim) {
     }
 }
 
+UI_INLINE unsigned int uiGetHandleHeader(const void *handle) {
+    // uiAllocHandle() stores a header in front of the handle
+    unsigned int header;
+    memcpy(&header, (const unsigned char *)handle - sizeof(unsigned int),
+        sizeof(unsigned int));
+    return header;
+}
+
+UI_INLINE unsigned int uiGetHandleSize(const void *handle) {
+    return uiGetHandleHeader(handle) & ((1u << UI_HANDLE_SIZE_BITS) - 1);
+}
+
+UI_INLINE unsigned int uiGetHandleAlignment(const void *handle) {
+    return 1u << (uiGetHandleHeader(handle) >> UI_HANDLE_SIZE_BITS);
+}
+
 UI_INLINE bool uiCompareItems(UIitem *item1, UIitem *item2) {
     return ((item1->flags & UI_ITEM_COMPARE_MASK) == (item2->flags & UI_ITEM_COMPARE_MASK));
 
@@ -1736,6 +2697,75 @@ int uiRecoverItem(int olditem) {
     return ui_context->item_map[olditem];
 }
 
+int uiReuseItem(int olditem) {
+    assert(ui_context);
+    // must run between uiBeginLayout() and uiEndLayout()
+    assert(ui_context->stage == UI_STAGE_LAYOUT);
+    assert(ui_context->flags & UI_CONTEXT_REUSE);
+    assert((olditem >= 0) && (olditem < ui_context->last_count));
+    const UIitem *pold = ui_context->decl_items + olditem;
+    int item = uiItem();
+    UIitem *pitem = uiItemPtr(item);
+    pitem->flags = pold->flags & ~(UI_ITEM_DATA|UI_ITEM_INSERTED);
+    memcpy(pitem->margins, pold->margins, sizeof(pitem->margins));
+    memcpy(pitem->size, pold->size, sizeof(pitem->size));
+    void *handle = *uiLastHandlePtr(olditem);
+    if (pold->flags & UI_ITEM_DATA) {
+        unsigned int size = uiGetHandleSize(handle);
+        memcpy(uiAllocHandleAligned(item, size,
+            uiGetHandleAlignment(handle)), handle, size);
+    } else {
+        *uiHandlePtr(item) = handle;
+    }
+    ui_context->item_map[olditem] = item;
+
+    int lastkid = -1;
+    int kid = pold->firstkid;
+    while (kid >= 0) {
+        int newkid = uiReuseItem(kid);
+        if (lastkid < 0)
+            uiInsert(item, newkid);
+        else
+            uiAppend(lastkid, newkid);
+        lastkid = newkid;
+        kid = ui_context->decl_items[kid].nextitem;
+    }
+    return item;
+}
+
+int uiPlaceholder(int olditem) {
+    assert(ui_context);
+    // must run between uiBeginLayout() and uiEndLayout()
+    assert(ui_context->stage == UI_STAGE_LAYOUT);
+    assert((olditem >= -1) && (olditem < ui_context->last_count));
+    if (olditem == -1) return -1;
+    if (ui_context->invalid_count > UI_MAX_INVALID_PLACEHOLDERS) return -1;
+    for (int i = 0; i < ui_context->invalid_count; ++i) {
+        if (ui_context->invalid_items[i] == olditem) return -1;
+    }
+    assert(ui_context->flags & UI_CONTEXT_REUSE);
+    const UIitem *pdecl = ui_context->decl_items + olditem;
+    const UIitem *pold = uiLastItemPtr(olditem);
+    int item = uiItem();
+    UIitem *pitem = uiItemPtr(item);
+    pitem->flags = pdecl->flags & UI_ITEM_LAYOUT_MASK;
+    memcpy(pitem->margins, pdecl->margins, sizeof(pitem->margins));
+    uiSetSize(item, pold->size[0], pold->size[1]);
+    ui_context->item_map[olditem] = item;
+    return item;
+}
+
+void uiInvalidatePlaceholder(int item) {
+    assert(ui_context && (item >= 0) && (item < ui_context->count));
+    assert(ui_context->stage != UI_STAGE_LAYOUT);
+    if (ui_context->invalid_count < UI_MAX_INVALID_PLACEHOLDERS) {
+        ui_context->invalid_items[ui_context->invalid_count] = item;
+    }
+    if (ui_context->invalid_count <= UI_MAX_INVALID_PLACEHOLDERS) {
+        ui_context->invalid_count++;
+    }
+}
+
 void uiRemapItem(int olditem, int newitem) {
     assert(ui_context);
     assert((olditem >= 0) && (olditem < ui_context->last_count));
@@ -1743,14 +2773,303 @@ void uiRemapItem(int olditem, int newitem) {
     ui_context->item_map[olditem] = newitem;
 }
 
+UI_INLINE int uiPersistentSizeClass(unsigned int size) {
+    int sclass = 0;
+    while ((16u << sclass) < size)
+        sclass++;
+    return sclass;
+}
+
+// take a block from the slabs; the caller links it into a list
+static UIpersistentBlock *uiAllocSlabBlock(int sclass) {
+    UIpersistentBlock *block = ui_context->persistent_free[sclass];
+    if (!block) {
+        // carve a new slab into free blocks of this size class
+        unsigned int stride = sizeof(UIpersistentBlock) + (16u << sclass);
+        unsigned char *slab = (unsigned char *)malloc(UI_PERSISTENT_SLAB_SIZE);
+        assert(slab);
+        *(void **)slab = ui_context->persistent_slabs;
+        ui_context->persistent_slabs = slab;
+        for (unsigned int offset = 2*sizeof(void *);
+                (offset + stride) <= UI_PERSISTENT_SLAB_SIZE;
+                offset += stride) {
+            UIpersistentBlock *free_block = (UIpersistentBlock *)(slab + offset);
+            free_block->next = block;
+            block = free_block;
+        }
+    }
+    ui_context->persistent_free[sclass] = block->next;
+    block->item = -1;
+    block->age = 0;
+    block->sclass = sclass;
+    return block;
+}
+
+UI_INLINE void uiLinkBlock(UIpersistentBlock **list, UIpersistentBlock *block) {
+    block->prev = NULL;
+    block->next = *list;
+    if (block->next)
+        block->next->prev = block;
+    *list = block;
+}
+
+// unlink block from list and return it to the slabs
+static void uiFreeSlabBlock(UIpersistentBlock **list, UIpersistentBlock *block) {
+    if (block->prev)
+        block->prev->next = block->next;
+    else
+        *list = block->next;
+    if (block->next)
+        block->next->prev = block->prev;
+    block->next = ui_context->persistent_free[block->sclass];
+    ui_context->persistent_free[block->sclass] = block;
+}
+
+static UIpersistentBlock *uiAllocPersistentBlock(int sclass) {
+    UIpersistentBlock *block = uiAllocSlabBlock(sclass);
+    uiLinkBlock(&ui_context->persistent_blocks, block);
+    return block;
+}
+
+static void uiReleasePersistentBlock(UIpersistentBlock *block) {
+    uiFreeSlabBlock(&ui_context->persistent_blocks, block);
+}
+
+// hand the persistent blocks of the old items over to the new items
+static void uiMapPersistentBlocks() {
+    for (int i = 0; i < ui_context->last_count; ++i) {
+        ui_context->persistent_map[i] = NULL;
+    }
+    UIpersistentBlock *block = ui_context->persistent_blocks;
+    while (block) {
+        UIpersistentBlock *next = block->next;
+        int item = uiRecoverItem(block->item);
+        if ((item >= 0) && !ui_context->persistent_map[item]) {
+            block->item = item;
+            block->age = 0;
+            ui_context->persistent_map[item] = block;
+        } else {
+            block->item = -1;
+            if (++block->age > UI_PERSISTENT_LIFETIME)
+                uiReleasePersistentBlock(block);
+        }
+        block = next;
+    }
+}
+
+UI_INLINE int uiPersistentItemCount() {
+    // blocks are moved to the new items in uiEndLayout()
+    return (ui_context->stage == UI_STAGE_LAYOUT)?
+        ui_context->last_count:ui_context->count;
+}
+
+void *uiGetPersistent(int item, unsigned int size) {
+    assert(ui_context);
+    assert((size > 0) && (size < UI_MAX_DATASIZE));
+    assert((item >= 0) && (item < uiPersistentItemCount()));
+    UIpersistentBlock *block = ui_context->persistent_map[item];
+    int sclass = uiPersistentSizeClass(size);
+    if (block && (block->sclass >= sclass))
+        return block + 1;
+    UIpersistentBlock *newblock = uiAllocPersistentBlock(sclass);
+    memset(newblock + 1, 0, 16u << sclass);
+    if (block) {
+        memcpy(newblock + 1, block + 1, 16u << block->sclass);
+        uiReleasePersistentBlock(block);
+    }
+    newblock->item = item;
+    ui_context->persistent_map[item] = newblock;
+    return newblock + 1;
+}
+
+// interned strings are kept in persistent blocks, prefixed by their hash
+UI_INLINE unsigned int *uiInternHash(UIpersistentBlock *block) {
+    return (unsigned int *)(block + 1);
+}
+
+UI_INLINE char *uiInternText(UIpersistentBlock *block) {
+    return (char *)(uiInternHash(block) + 1);
+}
+
+// release interned strings that have not been used for too long
+static void uiAgeInternedStrings() {
+    for (int i = 0; i < UI_INTERN_BUCKETS; ++i) {
+        UIpersistentBlock *block = ui_context->intern_buckets[i];
+        while (block) {
+            UIpersistentBlock *next = block->next;
+            if (++block->age > UI_PERSISTENT_LIFETIME)
+                uiFreeSlabBlock(&ui_context->intern_buckets[i], block);
+            block = next;
+        }
+    }
+}
+
+void uiFreePersistent(int item) {
+    assert(ui_context);
+    assert((item >= 0) && (item < uiPersistentItemCount()));
+    UIpersistentBlock *block = ui_context->persistent_map[item];
+    if (!block) return;
+    uiReleasePersistentBlock(block);
+    ui_context->persistent_map[item] = NULL;
+}
+
+UI_INLINE UIitemState uiComputeState(const UIitem *pitem, int item,
+        int hot_item, int active_item, int focus_item) {
+    if (pitem->flags & UI_ITEM_FROZEN) return UI_FROZEN;
+    if (focus_item == item) {
+        if (pitem->flags & (UI_KEY_DOWN|UI_CHAR|UI_KEY_UP)) return UI_ACTIVE;
+    }
+    if (active_item == item) {
+        if (pitem->flags & (UI_BUTTON0_CAPTURE|UI_BUTTON0_UP)) return UI_ACTIVE;
+        if ((pitem->flags & UI_BUTTON0_HOT_UP)
+                && (hot_item == item)) return UI_ACTIVE;
+        return UI_COLD;
+    } else if (hot_item == item) {
+        return UI_HOT;
+    }
+    return UI_COLD;
+}
+
+// returns true if the old item would be drawn exactly like the new item
+static bool uiIsUnchanged(int olditem, int item) {
+    UIitem *pold = uiLastItemPtr(olditem);
+    UIitem *pitem = uiItemPtr(item);
+    if ((pold->flags != pitem->flags)
+        || (pold->margins[0] != pitem->margins[0])
+        || (pold->margins[1] != pitem->margins[1])
+        || (pold->size[0] != pitem->size[0])
+        || (pold->size[1] != pitem->size[1])) {
+        return false;
+    }
+    void *oldhandle = *uiLastHandlePtr(olditem);
+    void *handle = *uiHandlePtr(item);
+    if (pitem->flags & UI_ITEM_DATA) {
+        unsigned int size = uiGetHandleSize(handle);
+        if ((uiGetHandleSize(oldhandle) != size)
+            || memcmp(oldhandle, handle, size)) {
+            return false;
+        }
+    } else if (oldhandle != handle) {
+        return false;
+    }
+    return uiComputeState(pold, olditem,
+            ui_context->drawn_hot_item,
+            ui_context->drawn_active_item,
+            ui_context->drawn_focus_item) == uiGetState(item);
+}
+
+static void uiAddDirtyRect(const UIitem *pitem) {
+    int x1 = pitem->margins[0];
+    int y1 = pitem->margins[1];
+    int x2 = x1 + pitem->size[0];
+    int y2 = y1 + pitem->size[1];
+    if ((x1 >= x2) || (y1 >= y2)) return;
+    UIrect *rects = ui_context->dirty_rects;
+    while (true) {
+        // merge with the first rectangle that overlaps or touches this one
+        int best = -1;
+        for (int i = 0; i < ui_context->dirty_count; ++i) {
+            if ((x1 <= (rects[i].x + rects[i].w)) && (rects[i].x <= x2)
+                && (y1 <= (rects[i].y + rects[i].h)) && (rects[i].y <= y2)) {
+                best = i;
+                break;
+            }
+        }
+        if (best < 0) {
+            if (ui_context->dirty_count < UI_MAX_DIRTY_RECTS) {
+                UIrect *rc = &rects[ui_context->dirty_count++];
+                rc->x = x1;
+                rc->y = y1;
+                rc->w = x2 - x1;
+                rc->h = y2 - y1;
+                return;
+            }
+            // out of rectangles; merge with the one that grows the least
+            long long best_growth = 0;
+            for (int i = 0; i < ui_context->dirty_count; ++i) {
+                long long w = ui_max(x2, rects[i].x + rects[i].w)
+                    - ui_min(x1, rects[i].x);
+                long long h = ui_max(y2, rects[i].y + rects[i].h)
+                    - ui_min(y1, rects[i].y);
+                long long growth = w*h - (long long)rects[i].w*rects[i].h;
+                if ((best < 0) || (growth < best_growth)) {
+                    best = i;
+                    best_growth = growth;
+                }
+            }
+        }
+        x1 = ui_min(x1, rects[best].x);
+        y1 = ui_min(y1, rects[best].y);
+        x2 = ui_max(x2, rects[best].x + rects[best].w);
+        y2 = ui_max(y2, rects[best].y + rects[best].h);
+        // the merged rectangle may now touch others; add it again
+        rects[best] = rects[--ui_context->dirty_count];
+    }
+}
+
+// collect the rectangles of all old items without an unchanged new item and
+// of all new items without an unchanged old item
+static void uiComputeDamage() {
+    ui_context->dirty_count = 0;
+    if (!ui_context->damage_tracking || !ui_context->handle_headers
+        || !ui_context->last_handle_headers) {
+        // nothing to compare; everything of both frames is damaged
+        if (ui_context->last_count)
+            uiAddDirtyRect(uiLastItemPtr(0));
+        if (ui_context->count)
+            uiAddDirtyRect(uiItemPtr(0));
+        return;
+    }
+    for (int i = 0; i < ui_context->count; ++i) {
+        ui_context->reverse_map[i] = -1;
+    }
+    for (int i = 0; i < ui_context->last_count; ++i) {
+        int item = ui_context->item_map[i];
+        if ((item >= 0) && uiIsUnchanged(i, item)) {
+            ui_context->reverse_map[item] = i;
+        } else {
+            uiAddDirtyRect(uiLastItemPtr(i));
+        }
+    }
+    for (int i = 0; i < ui_context->count; ++i) {
+        if (ui_context->reverse_map[i] < 0) {
+            uiAddDirtyRect(uiItemPtr(i));
+        }
+    }
+}
+
+void uiSetDamageTracking(int enabled) {
+    assert(ui_context);
+    ui_context->damage_tracking = (enabled != 0);
+}
+
+int uiGetDirtyRectCount() {
+    assert(ui_context);
+    return ui_context->dirty_count;
+}
+
+UIrect uiGetDirtyRect(int index) {
+    assert(ui_context && (index >= 0) && (index < ui_context->dirty_count));
+    return ui_context->dirty_rects[index];
+}
+
 void uiEndLayout() {
     assert(ui_context);
     assert(ui_context->stage == UI_STAGE_LAYOUT); // must run uiBeginLayout() first
 
+    // layout overwrites margins and sizes; keep the declaration for
+    // uiReuseItem() in the next frame
+    if (ui_context->decl_items) {
+        memcpy(ui_context->decl_items, ui_context->items,
+            sizeof(UIitem) * ui_context->count);
+    }
+
     if (ui_context->count) {
-        uiComputeSize(0,0);
+        uiComputeSize(0,0,false);
         uiArrange(0,0);
-        uiComputeSize(0,1);
+        // widths are final now; the measure handler can compute heights
+        // for them
+        uiComputeSize(0,1,false);
         uiArrange(0,1);
 
         if (ui_context->last_count) {
@@ -1760,11 +3079,20 @@ void uiEndLayout() {
     }
 
     uiValidateStateItems();
+    uiMapPersistentBlocks();
+    uiAgeInternedStrings();
     if (ui_context->count) {
         // drawing routines may require this to be set already
         uiUpdateHotItem();
     }
 
+    uiComputeDamage();
+    // invalidations only apply to the items declared before this layout
+    ui_context->invalid_count = 0;
+    ui_context->drawn_hot_item = ui_context->last_hot_item;
+    ui_context->drawn_active_item = ui_context->active_item;
+    ui_context->drawn_focus_item = ui_context->focus_item;
+
     ui_context->stage = UI_STAGE_POST_LAYOUT;
 }
 
@@ -1785,25 +3113,156 @@ int uiNextSibling(int item) {
     return uiItemPtr(item)->nextitem;
 }
 
+UI_INLINE unsigned char *uiAlignPointer(unsigned char *ptr,
+        unsigned int alignment) {
+    uintptr_t mask = (uintptr_t)alignment - 1;
+    return ptr + ((((uintptr_t)ptr + mask) & ~mask) - (uintptr_t)ptr);
+}
+
+// returns the size of the header in front of handles of this frame
+UI_INLINE unsigned int uiHandleHeaderSize() {
+    return ui_context->handle_headers?sizeof(unsigned int):0;
+}
+
+// allocate a handle from a chunk, reusing a spare chunk if one is large enough
+static unsigned char *uiAllocChunk(unsigned int size, unsigned int alignment) {
+    // room for the header and for aligning the handle
+    size_t need = uiHandleHeaderSize() + (alignment - 1) + size;
+    UIchunk **spare = &ui_context->spare_chunks;
+    while (*spare && ((*spare)->capacity < need))
+        spare = &(*spare)->next;
+    UIchunk *chunk = *spare;
+    if (chunk) {
+        *spare = chunk->next;
+    } else {
+        chunk = (UIchunk *)malloc(sizeof(UIchunk) + need);
+        assert(chunk);
+        chunk->capacity = need;
+    }
+    chunk->next = ui_context->chunks;
+    ui_context->chunks = chunk;
+    return uiAlignPointer((unsigned char *)(chunk + 1) + uiHandleHeaderSize(),
+        alignment);
+}
+
+void *uiAllocHandleAligned(int item, unsigned int size,
+        unsigned int alignment) {
+    assert((size > 0) && (size < (1u << UI_HANDLE_SIZE_BITS)));
+    assert(alignment && !(alignment & (alignment - 1)));
+    assert(*uiHandlePtr(item) == NULL);
+    unsigned char *handle = NULL;
+    if ((size < UI_MAX_DATASIZE) && ui_context->data) {
+        handle = uiAlignPointer(ui_context->data + ui_context->datasize
+            + uiHandleHeaderSize(), alignment);
+        unsigned int end = (unsigned int)(handle - ui_context->data) + size;
+        if (end <= ui_context->buffer_capacity) {
+            ui_context->datasize = end;
+        } else {
+            handle = NULL;
+        }
+    }
+    if (!handle) {
+        handle = uiAllocChunk(size, alignment);
+    }
+    // keep size and alignment in front of the handle for uiComputeDamage()
+    // and uiReuseItem()
+    if (ui_context->handle_headers) {
+        unsigned int shift = 0;
+        while ((1u << shift) < alignment)
+            shift++;
+        unsigned int header = size | (shift << UI_HANDLE_SIZE_BITS);
+        memcpy(handle - sizeof(unsigned int), &header, sizeof(unsigned int));
+    }
+    *uiHandlePtr(item) = handle;
+    uiItemPtr(item)->flags |= UI_ITEM_DATA;
+    return handle;
+}
+
 void *uiAllocHandle(int item, unsigned int size) {
-    assert((size > 0) && (size < UI_MAX_DATASIZE));
-    UIitem *pitem = uiItemPtr(item);
-    assert(pitem->handle == NULL);
-    assert((ui_context->datasize+size) <= ui_context->buffer_capacity);
-    pitem->handle = ui_context->data + ui_context->datasize;
-    pitem->flags |= UI_ITEM_DATA;
-    ui_context->datasize += size;
-    return pitem->handle;
+    return uiAllocHandleAligned(item, size, 1);
+}
+
+// returns size bytes for a string from the handle buffer, or from a chunk if
+// the buffer is full
+static char *uiAllocText(unsigned int size) {
+    if (ui_context->data
+        && (size <= (ui_context->buffer_capacity - ui_context->datasize))) {
+        char *str = (char *)ui_context->data + ui_context->datasize;
+        ui_context->datasize += size;
+        return str;
+    }
+    return (char *)uiAllocChunk(size, 1);
+}
+
+char *uiAllocString(const char *text) {
+    assert(ui_context && text);
+    unsigned int size = (unsigned int)strlen(text) + 1;
+    char *str = uiAllocText(size);
+    memcpy(str, text, size);
+    return str;
+}
+
+const char *uiFormat(const char *format, ...) {
+    assert(ui_context && format);
+    unsigned int space = ui_context->data
+        ? (ui_context->buffer_capacity - ui_context->datasize) : 0;
+    char *str = space ? ((char *)ui_context->data + ui_context->datasize) : NULL;
+    va_list args;
+    va_start(args, format);
+    // format directly into the buffer
+    int length = vsnprintf(str, space, format, args);
+    va_end(args);
+    if (length < 0) {
+        // encoding error
+        str = uiAllocText(1);
+        str[0] = '\0';
+        return str;
+    }
+    if ((unsigned int)length < space) {
+        ui_context->datasize += length + 1;
+        return str;
+    }
+    // truncated; format again into a chunk
+    str = (char *)uiAllocChunk(length + 1, 1);
+    va_start(args, format);
+    vsnprintf(str, length + 1, format, args);
+    va_end(args);
+    return str;
+}
+
+const char *uiIntern(const char *text) {
+    assert(ui_context && text);
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    unsigned int length = 0;
+    for (const char *c = text; *c; ++c, ++length) {
+        hash = (hash ^ (unsigned char)*c) * 16777619u;
+    }
+    UIpersistentBlock **bucket =
+        &ui_context->intern_buckets[hash % UI_INTERN_BUCKETS];
+    for (UIpersistentBlock *block = *bucket; block; block = block->next) {
+        if ((*uiInternHash(block) == hash)
+            && !strcmp(uiInternText(block), text)) {
+            block->age = 0;
+            return uiInternText(block);
+        }
+    }
+    unsigned int size = sizeof(unsigned int) + length + 1;
+    assert(size < UI_MAX_DATASIZE);
+    UIpersistentBlock *block = uiAllocSlabBlock(uiPersistentSizeClass(size));
+    uiLinkBlock(bucket, block);
+    *uiInternHash(block) = hash;
+    memcpy(uiInternText(block), text, length + 1);
+    return uiInternText(block);
 }
 
 void uiSetHandle(int item, void *handle) {
-    UIitem *pitem = uiItemPtr(item);
-    assert(pitem->handle == NULL);
-    pitem->handle = handle;
+    assert(*uiHandlePtr(item) == NULL);
+    *uiHandlePtr(item) = handle;
 }
 
 void *uiGetHandle(int item) {
-    return uiItemPtr(item)->handle;
+    return *uiHandlePtr(item);
 }
 
 void uiSetHandler(UIhandler handler) {
@@ -1816,6 +3275,16 @@ UIhandler uiGetHandler() {
     return ui_context->handler;
 }
 
+void uiSetMeasureHandler(UImeasureHandler handler) {
+    assert(ui_context);
+    ui_context->measure_handler = handler;
+}
+
+UImeasureHandler uiGetMeasureHandler() {
+    assert(ui_context);
+    return ui_context->measure_handler;
+}
+
 void uiSetEvents(int item, unsigned int flags) {
     UIitem *pitem = uiItemPtr(item);
     pitem->flags &= ~UI_ITEM_EVENT_MASK;
@@ -1893,6 +3362,8 @@ void uiProcess(int timestamp) {
         uiUpdateHotItem();
     }
     ui_context->stage = UI_STAGE_PROCESS;
+    // input passed in so far is handled now
+    ui_context->redraw = 0;
 
     if (!ui_context->count) {
         uiClearInputEvents();
@@ -1902,6 +3373,16 @@ void uiProcess(int timestamp) {
     int hot_item = ui_context->last_hot_item;
     int active_item = ui_context->active_item;
     int focus_item = ui_context->focus_item;
+    int old_hot_item = hot_item;
+    int old_active_item = active_item;
+    int old_focus_item = focus_item;
+
+    if (ui_context->clicks && ((timestamp - ui_context->last_click_timestamp)
+            > UI_CLICK_THRESHOLD)) {
+        // handlers may draw items differently for uiGetClicks()
+        ui_context->clicks = 0;
+        ui_context->redraw = 1;
+    }
 
     // send all keyboard events
     if (focus_item >= 0) {
@@ -1994,40 +3475,36 @@ void uiProcess(int timestamp) {
     ui_context->last_hot_item = hot_item;
     ui_context->active_item = active_item;
 
+    if ((hot_item != old_hot_item)
+        || (active_item != old_active_item)
+        || (ui_context->focus_item != old_focus_item)) {
+        ui_context->redraw = 1;
+    }
+
     ui_context->last_timestamp = timestamp;
     ui_context->last_buttons = ui_context->buttons;
 }
 
-static int uiIsActive(int item) {
-    assert(ui_context);
-    return ui_context->active_item == item;
-}
-
-static int uiIsHot(int item) {
+int uiNeedsRedraw() {
     assert(ui_context);
-    return ui_context->last_hot_item == item;
+    // the damage of a layout is drawn before the next uiProcess()
+    return (ui_context->redraw
+        || (ui_context->dirty_count
+            && (ui_context->stage == UI_STAGE_POST_LAYOUT)))?1:0;
 }
 
-static int uiIsFocused(int item) {
+int uiGetNextDeadline() {
     assert(ui_context);
-    return ui_context->focus_item == item;
+    if (!ui_context->clicks) return -1;
+    return ui_context->last_click_timestamp + UI_CLICK_THRESHOLD + 1;
 }
 
 UIitemState uiGetState(int item) {
-    UIitem *pitem = uiItemPtr(item);
-    if (pitem->flags & UI_ITEM_FROZEN) return UI_FROZEN;
-    if (uiIsFocused(item)) {
-        if (pitem->flags & (UI_KEY_DOWN|UI_CHAR|UI_KEY_UP)) return UI_ACTIVE;
-    }
-    if (uiIsActive(item)) {
-        if (pitem->flags & (UI_BUTTON0_CAPTURE|UI_BUTTON0_UP)) return UI_ACTIVE;
-        if ((pitem->flags & UI_BUTTON0_HOT_UP)
-                && uiIsHot(item)) return UI_ACTIVE;
-        return UI_COLD;
-    } else if (uiIsHot(item)) {
-        return UI_HOT;
-    }
-    return UI_COLD;
+    assert(ui_context);
+    return uiComputeState(uiItemPtr(item), item,
+            ui_context->last_hot_item,
+            ui_context->active_item,
+            ui_context->focus_item);
 }
 
 #endif // OUI_IMPLEMENTATION